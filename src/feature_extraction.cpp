@@ -32,10 +32,10 @@ using namespace AF;
 
 ////////////////////////////////////////////////////////////////////////////////
 // 'FeatureValue()' constructor.  It takes the name of a feature and
-// its value.
+// its value, and optionally the id of the extractor that computed it.
 ////////////////////////////////////////////////////////////////////////////////
-FeatureValue::FeatureValue(const StringXML& feature, double value)
-    :_feature(feature),_value(value) {
+FeatureValue::FeatureValue(const StringXML& feature, double value,
+    const int id):_feature(feature),_value(value),_id(id) {
 }
 
 
@@ -56,13 +56,29 @@ FeatureValue::getValue() const {
   return _value;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// 'getId()' returns the id of the extractor that computed the feature
+////////////////////////////////////////////////////////////////////////////////
+int
+FeatureValue::getId() const {
+  return _id;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 'setId()' sets the id of the extractor that computed the feature
+////////////////////////////////////////////////////////////////////////////////
+void
+FeatureValue::setId(const int id) {
+  _id = id;
+}
+
 
 ////////////////////////////////////////////////////////////////////////////////
 // 'FeatureValueExtractor()' constructor.
 ////////////////////////////////////////////////////////////////////////////////
 FeatureValueExtractor::FeatureValueExtractor(const StringXML name,
     const int context,const StringXML alias)
-    :_feature_name(name),_context(context),_alias(alias) {
+    :_feature_name(name),_context(context),_alias(alias),_shiftOf(-1) {
   setWeight(1);
 }
 
@@ -111,6 +127,44 @@ FeatureValueExtractor::getContext() const{
     return _context;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// 'usesClassification' returns true if the feature depends on the
+// classification of other tokens.  Most features do not.
+////////////////////////////////////////////////////////////////////////////////
+bool
+FeatureValueExtractor::usesClassification() const {
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 'isShiftable' returns true if the value of the feature on a token is the
+// value of the feature with context 0 on the token 'context' away.  Most
+// features are; those that are not override it.
+////////////////////////////////////////////////////////////////////////////////
+bool
+FeatureValueExtractor::isShiftable() const {
+  return true;
+}
+
+void
+FeatureValueExtractor::setShiftOf(const int id) {
+  _shiftOf = id;
+}
+
+int
+FeatureValueExtractor::getShiftOf() const {
+  return _shiftOf;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 'shiftedValue' returns the FeatureValue of 'value', named as the
+// extractor names the values it computes.
+////////////////////////////////////////////////////////////////////////////////
+FeatureValue
+FeatureValueExtractor::shiftedValue(const double value) const {
+  return FeatureValue(_alias,value);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Default constructor
 ////////////////////////////////////////////////////////////////////////////////
@@ -171,6 +225,37 @@ FeatureVectorValueExtractor::setDefaultFeatureWeight(const double weight) {
   }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// 'getFeatureNames' returns the name given to the features computed by
+// each FeatureValueExtractor, in the order they are applied.
+////////////////////////////////////////////////////////////////////////////////
+vector<StringXML>
+FeatureVectorValueExtractor::getFeatureNames() const {
+  vector<StringXML> names;
+  for (vector<FeatureValueExtractor*>::const_iterator
+      i=_featureAlgorithms.begin(); i!=_featureAlgorithms.end();
+      ++i) {
+    names.push_back((*i)->getAlias());
+  }
+  return names;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 'usesClassification' returns true if any feature with a weight above 0
+// depends on the classification of other tokens
+////////////////////////////////////////////////////////////////////////////////
+bool
+FeatureVectorValueExtractor::usesClassification() const {
+  for (vector<FeatureValueExtractor*>::const_iterator
+      i=_featureAlgorithms.begin(); i!=_featureAlgorithms.end();
+      ++i) {
+    if (((*i)->getWeight()>0)&&((*i)->usesClassification())) {
+      return true;
+    }
+  }
+  return false;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // 'operator()()' applies the FeatureValueExtractor algorithms to
 // the index in vector<TokenDeco> and returns a FeatureVector for that
@@ -187,6 +272,7 @@ FeatureVectorValueExtractor::operator()(vector<TokenDeco>& tokens,
     // Run only if the weight of the feature is >0 or if ignore
     if (((*i)->getWeight()>0)||(ignoreWeights)) {
       FeatureValue fv=(*(*i))(tokens, index,text);
+      fv.setId(i-_featureAlgorithms.begin());
       result.push_back(fv);
     }
   }
@@ -203,12 +289,47 @@ FeatureVectorValueExtractor::operator()(vector<TokenDeco>& tokens,
 vector<FeatureVector>
 FeatureVectorValueExtractor::operator()(vector<TokenDeco>& tokens,
     const StringXML& text,const bool ignoreWeights) const {
-  vector<FeatureVector> results;
-  int j=0;
-  for (vector<TokenDeco>::iterator i=tokens.begin(); i!=tokens.end();
+  const int count = tokens.size();
+  // the positions of the extractors that are run
+  vector<int> run;
+  for (vector<FeatureValueExtractor*>::const_iterator
+      i=_featureAlgorithms.begin(); i!=_featureAlgorithms.end();
       ++i) {
-    results.push_back(this->operator()(tokens,i,text,ignoreWeights));
-    j++;
+    if (((*i)->getWeight()>0)||(ignoreWeights)) {
+      run.push_back(i-_featureAlgorithms.begin());
+    }
+  }
+  // the values, for every token, of the extractors with context 0 that
+  // extractors run read shifted
+  vector<vector<double> > values(_featureAlgorithms.size());
+  for (vector<int>::const_iterator i=run.begin();i!=run.end();++i) {
+    const int base = _featureAlgorithms[*i]->getShiftOf();
+    if ((base>=0)&&(values[base].empty())) {
+      values[base].reserve(count);
+      for (vector<TokenDeco>::iterator t=tokens.begin(); t!=tokens.end();
+          ++t) {
+        values[base].push_back((*_featureAlgorithms[base])(tokens,t,text)
+            .getValue());
+      }
+    }
+  }
+  vector<FeatureVector> results(count);
+  for (int t=0;t<count;t++) {
+    FeatureVector& result = results[t];
+    result.reserve(run.size());
+    for (vector<int>::const_iterator i=run.begin();i!=run.end();++i) {
+      const FeatureValueExtractor* extractor = _featureAlgorithms[*i];
+      const int base = extractor->getShiftOf();
+      const int shifted = t+extractor->getContext();
+      // tokens out of the document are left to the extractor
+      if ((base>=0)&&(shifted>=0)&&(shifted<count)) {
+        result.push_back(extractor->shiftedValue(values[base][shifted]));
+      }
+      else {
+        result.push_back((*extractor)(tokens,tokens.begin()+t,text));
+      }
+      result.back().setId(*i);
+    }
   }
   return results;
 }
@@ -46,9 +46,9 @@ class FeatureValue {
 public:
 ////////////////////////////////////////////////////////////////////////////////
 // 'FeatureValue()' constructor.  It takes the name of a feature and
-// its value.
+// its value, and optionally the id of the extractor that computed it.
 ////////////////////////////////////////////////////////////////////////////////
-  FeatureValue(const StringXML& feature, double value);
+  FeatureValue(const StringXML& feature, double value, const int id=-1);
   
 ////////////////////////////////////////////////////////////////////////////////
 // 'getFeature()' returns the name of the feature.
@@ -61,6 +61,17 @@ public:
 ////////////////////////////////////////////////////////////////////////////////
   double
   getValue() const;
+
+////////////////////////////////////////////////////////////////////////////////
+// 'getId()' returns the position of the extractor that computed the
+// feature in its FeatureVectorValueExtractor, or -1 if unknown.
+// 'setId()' sets it.
+////////////////////////////////////////////////////////////////////////////////
+  int
+  getId() const;
+
+  void
+  setId(const int id);
   
 protected:
 private:
@@ -74,6 +85,11 @@ private:
 ////////////////////////////////////////////////////////////////////////////////
   double _value;
 
+////////////////////////////////////////////////////////////////////////////////
+// '_id' stores the id of the extractor that computed the feature
+////////////////////////////////////////////////////////////////////////////////
+  int _id;
+
 };
 
 
@@ -129,6 +145,40 @@ public:
   int
   getContext() const;
 
+////////////////////////////////////////////////////////////////////////////////
+// 'usesClassification' returns true if the feature depends on the
+// classification of other tokens, in which case tokens must be classified
+// one at a time, in order.
+////////////////////////////////////////////////////////////////////////////////
+  virtual bool
+  usesClassification() const;
+
+////////////////////////////////////////////////////////////////////////////////
+// 'isShiftable' returns true if the value of the feature on a token is the
+// value of the same feature with context 0 on the token 'context' away, so
+// that it can be computed once per token and read shifted.
+////////////////////////////////////////////////////////////////////////////////
+  virtual bool
+  isShiftable() const;
+
+////////////////////////////////////////////////////////////////////////////////
+// 'setShiftOf' records the position, in its FeatureVectorValueExtractor, of
+// the extractor with context 0 whose values this one reads shifted, and
+// 'getShiftOf' returns it, or -1 if the values are computed by this one.
+////////////////////////////////////////////////////////////////////////////////
+  void
+  setShiftOf(const int id);
+
+  int
+  getShiftOf() const;
+
+////////////////////////////////////////////////////////////////////////////////
+// 'shiftedValue' returns the FeatureValue this extractor computes when the
+// value of the feature is 'value'.
+////////////////////////////////////////////////////////////////////////////////
+  virtual FeatureValue
+  shiftedValue(const double value) const;
+
 ////////////////////////////////////////////////////////////////////////////////
 // '~FeatureValueExtractor()' destructor.
 ////////////////////////////////////////////////////////////////////////////////
@@ -153,6 +203,7 @@ protected:
   const int _context;
   StringXML _alias;
   double _weight;
+  int _shiftOf;
 private:
 };
 
@@ -184,6 +235,20 @@ public:
 
   void
   setDefaultFeatureWeight(const double weight);
+
+////////////////////////////////////////////////////////////////////////////////
+// 'getFeatureNames' returns the name given to the features computed by
+// each FeatureValueExtractor, indexed by the id set in the FeatureValues.
+////////////////////////////////////////////////////////////////////////////////
+  vector<StringXML>
+  getFeatureNames() const;
+
+////////////////////////////////////////////////////////////////////////////////
+// 'usesClassification' returns true if any feature that is computed (weight
+// above 0) depends on the classification of other tokens.
+////////////////////////////////////////////////////////////////////////////////
+  bool
+  usesClassification() const;
 ////////////////////////////////////////////////////////////////////////////////
 // 'operator()()' applies the FeatureValueExtractor algorithms to
 // the index in vector<Token> and returns a FeatureVector for that
@@ -198,7 +263,9 @@ public:
 // 'operator()()' applies the FeatureValueExtractor algorithms to
 // the vector<Token> and returns a vector<FeatureVector> that has the
 // same length of the vector of tokens.  For each token, a feature
-// vector will be computed and returned in the same order.
+// vector will be computed and returned in the same order.  The features
+// that are shifts of a feature with context 0 are computed once per token,
+// and read at each context.
 ////////////////////////////////////////////////////////////////////////////////
   virtual vector<FeatureVector>
   operator()(vector<TokenDeco>& tokens,const StringXML& text,
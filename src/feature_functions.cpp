@@ -31,6 +31,7 @@
 #include <vector>
 #include <string>
 #include <cctype>
+#include <cstring>
 #include <sstream>
 #include "tokeniser.h"
 #include "feature_extraction.h"
@@ -80,6 +81,42 @@ incrementIterator(const vector<TokenDeco>& vec,
   // if reach here, done properly
   return true;
 }
+
+////////////////////////////////////////////////////////////////////////////////
+// The slots of the information the extractors store in the tokens
+////////////////////////////////////////////////////////////////////////////////
+static const int initCapsInfo=InfoRegistry::slot("initCaps");
+static const int allCapsInfo=InfoRegistry::slot("allCaps");
+static const int mixedCapsInfo=InfoRegistry::slot("mixedCaps");
+static const int isSentEndInfo=InfoRegistry::slot("isSentEnd");
+static const int initCapPeriodInfo=InfoRegistry::slot("initCapPeriod");
+static const int oneCapInfo=InfoRegistry::slot("oneCap");
+static const int containDigitInfo=InfoRegistry::slot("containDigit");
+static const int twoDigitsInfo=InfoRegistry::slot("twoDigits");
+static const int fourDigitsInfo=InfoRegistry::slot("fourDigits");
+static const int monthNameInfo=InfoRegistry::slot("monthName");
+static const int dayOfTheWeekInfo=InfoRegistry::slot("dayOfTheWeek");
+static const int numberStringInfo=InfoRegistry::slot("numberString");
+static const int prepPrecededInfo=InfoRegistry::slot("prepPreceded");
+static const int alwaysCappedInfo=InfoRegistry::slot("alwaysCapped");
+static const int maxProbInfo=InfoRegistry::slot("maxProb");
+
+////////////////////////////////////////////////////////////////////////////////
+// 'capitalisedIn' returns true if the token, with its first letter made upper
+// case, is one of 'words', a list ended by 0.  As StringXML::at does, it
+// throws out_of_range for an empty token.
+////////////////////////////////////////////////////////////////////////////////
+static bool
+capitalisedIn(const TokenView& token,const char* const words[]) {
+  const char first=toupper(token.at(0));
+  for (const char* const* word=words;*word!=0;word++) {
+    if ((*word)[0]==first && strlen(*word)==token.length() &&
+        memcmp(token.begin()+1,*word+1,token.length()-1)==0) {
+      return true;
+    }
+  }
+  return false;
+}
 ////////////////////////////////////////////////////////////////////////////////
 // 'operator()()' computes the FeatureValue.  It works on tokens and
 // computes the value of a feature of the particular index.
@@ -109,21 +146,17 @@ InitCaps::operator()(vector<TokenDeco>& tokens,
     const vector<TokenDeco>::iterator index,
     const StringXML& text) const {
   double value = 0.0;
-  // the name of the info stored in the token
-  StringXML infoName = "initCaps";
   vector<TokenDeco>::iterator checkIndex=index;
   // if able to increment/decrement
   if (incrementIterator(tokens,checkIndex,_context)&&checkIndex!=tokens.end()) {
     // compute the value if it has not been computed
-    if (!checkIndex->getInfo(infoName,value)) {
-      //Get the string of the token
-      StringXML tokenString = checkIndex->getString(text);
+    if (!checkIndex->getInfo(initCapsInfo,value)) {
       //Check first character
-      if (isupper(tokenString.at(0))) {
+      if (checkIndex->getShape()&SHAPE_INIT_CAP) {
         value = 1.0;
       }
       // set the information in the token
-      checkIndex->setInfo(infoName,value);
+      checkIndex->setInfo(initCapsInfo,value);
     }
   }
   //Return the name & value pair
@@ -149,22 +182,17 @@ AllCaps::operator()(vector<TokenDeco>& tokens,
     const vector<TokenDeco>::iterator index,
     const StringXML& text) const {
   double value = 1.0;
-  StringXML name = "allCaps";
   vector<TokenDeco>::iterator checkIndex=index;
   // if able to increment/decrement
   if (incrementIterator(tokens,checkIndex,_context)&&checkIndex!=tokens.end()) {
     // compute value if not already computed
-    if (!checkIndex->getInfo(name,value)){
-      StringXML tokenString = checkIndex->getString(text);
-      //Check all characters, until lower case is found
-      for (unsigned int i = 0; i < tokenString.length(); i++){
-        if (islower(tokenString.at(i))){
-          value = 0.0;
-          break;
-        }
+    if (!checkIndex->getInfo(allCapsInfo,value)){
+      //Check whether any character is lower case
+      if (checkIndex->getShape()&SHAPE_LOWER){
+        value = 0.0;
       }
       // set the value for future reference
-      checkIndex->setInfo(name,value);
+      checkIndex->setInfo(allCapsInfo,value);
     }
   }
   FeatureValue res(_alias,value);
@@ -190,38 +218,19 @@ MixedCaps::operator()(vector<TokenDeco>& tokens,
     const vector<TokenDeco>::iterator index,
     const StringXML& text) const {
   double value = 0.0;
-  StringXML name = "mixedCaps";
   vector<TokenDeco>::iterator checkIndex=index;
   // if able to increment/decrement
   if (incrementIterator(tokens,checkIndex,_context)&&checkIndex!=tokens.end()) {
     // compute if not already computed
-    if (!checkIndex->getInfo(name,value)){
-      StringXML tokenString = checkIndex->getString(text);
-      //Stores whether each case has been encountered yet
-      bool upcnt = 0;
-      bool lowcnt = 0;
-      for (unsigned int i = 0; i < tokenString.length(); i++) {
-        //case is mixed if a lower is encountered, and upper has already been 
-        //seen
-        if (islower(tokenString.at(i))) {
-          if (upcnt) {
-            value = 1.0;
-            break;
-          }
-          lowcnt = 1;
-        }
-        //case is mixed if a upper is encountered, and lower has already been 
-        //seen
-        else {
-          if (lowcnt){
-            value = 1.0;
-            break;
-          }
-          upcnt = 1;
-        }
+    if (!checkIndex->getInfo(mixedCapsInfo,value)){
+      //case is mixed if both a lower case character and a character that
+      //is not lower case are found
+      const unsigned int mixed = SHAPE_LOWER|SHAPE_NOT_LOWER;
+      if ((checkIndex->getShape()&mixed) == mixed) {
+        value = 1.0;
       }
       // set for future reference
-      checkIndex->setInfo(name,value);
+      checkIndex->setInfo(mixedCapsInfo,value);
     }
   }
   FeatureValue res(_alias,value);
@@ -246,18 +255,16 @@ IsSentEnd::operator()(vector<TokenDeco>& tokens,
     const vector<TokenDeco>::iterator index,
     const StringXML& text) const {
   double value = 0.0;
-  StringXML name = "isSentEnd";
   vector<TokenDeco>::iterator checkIndex=index;
   // if able to increment/decrement
   if (incrementIterator(tokens,checkIndex,_context)&&checkIndex!=tokens.end()) {
     // compute if not already computed
-    if (!checkIndex->getInfo(name,value)){
-      StringXML tokenString = checkIndex->getString(text);
-      //Check for match
-      if (tokenString == "." || tokenString == "!" || tokenString == "?"){
+    if (!checkIndex->getInfo(isSentEndInfo,value)){
+      //Check for ".", "!" or "?"
+      if (checkIndex->getShape()&SHAPE_SENT_END){
         value = 1.0;
       }
-      checkIndex->setInfo(name,value);
+      checkIndex->setInfo(isSentEndInfo,value);
     }
   }
   FeatureValue res(_alias,value);
@@ -282,22 +289,20 @@ InitCapPeriod::operator()(vector<TokenDeco>& tokens,
     const vector<TokenDeco>::iterator index,
     const StringXML& text) const {
   double value = 0.0;
-  StringXML name = "initCapPeriod";
   vector<TokenDeco>::iterator checkIndex=index;
   // if able to increment/decrement
   if (incrementIterator(tokens,checkIndex,_context)&&checkIndex!=tokens.end()) {
     // compute if not already computed
-    if (!checkIndex->getInfo(name,value)) {
-      StringXML tokenString = checkIndex->getString(text);
+    if (!checkIndex->getInfo(initCapPeriodInfo,value)) {
       vector<TokenDeco>::iterator next_index = checkIndex;
       next_index++;
       //Check the next token, and the first character of the current token
       if (next_index != tokens.end()) {
-        StringXML nextString = next_index->getString(text);
-        if (isupper(tokenString.at(0)) && nextString == ".")
+        if ((checkIndex->getShape()&SHAPE_INIT_CAP) &&
+            (next_index->getShape()&SHAPE_PERIOD))
           value = 1.0;
       }
-      checkIndex->setInfo(name,value);
+      checkIndex->setInfo(initCapPeriodInfo,value);
     }
   }
   FeatureValue res(_alias,value);
@@ -322,23 +327,28 @@ OneCap::operator()(vector<TokenDeco>& tokens,
     const vector<TokenDeco>::iterator index,
     const StringXML& text) const {
   double value = 0.0;
-  StringXML name = "oneCap";
   vector<TokenDeco>::iterator checkIndex=index;
   // if able to increment/decrement
   if (incrementIterator(tokens,checkIndex,_context)&&checkIndex!=tokens.end()) {
     // compute if not already computed
-    if (!checkIndex->getInfo(name,value)) {
-      StringXML tokenString = index->getString(text);
+    if (!checkIndex->getInfo(oneCapInfo,value)) {
       //Check the 2 conditions  
-      if (tokenString.length() == 1 && isupper(tokenString.at(0)))
+      if (index->getLength() == 1 && (index->getShape()&SHAPE_INIT_CAP))
         value = 1.0;
-      checkIndex->setInfo(name,value);
+      checkIndex->setInfo(oneCapInfo,value);
     }
   }
   FeatureValue res(_alias,value);
   return res;
 }
 
+// the value is looked up in the token at the context, but computed for the
+// current token, so it depends on the order the tokens are seen in
+bool
+OneCap::isShiftable() const {
+  return false;
+}
+
 ContainDigit::ContainDigit(const int& context,
     const StringXML alias)
     : FeatureValueExtractor("ContainDigit",context,alias) {
@@ -357,26 +367,28 @@ ContainDigit::operator()(vector<TokenDeco>& tokens,
     const vector<TokenDeco>::iterator index,
     const StringXML& text) const {
   double value = 0.0;
-  StringXML name = "containDigit";
   vector<TokenDeco>::iterator checkIndex=index;
   // if able to increment/decrement
   if (incrementIterator(tokens,checkIndex,_context)&&checkIndex!=tokens.end()) {
     // compute if not already computed
-    if (!checkIndex->getInfo(name,value)) {
-      StringXML tokenString = checkIndex->getString(text);
+    if (!checkIndex->getInfo(containDigitInfo,value)) {
       //Search string for a digit   
-      for (unsigned int i = 0; i < tokenString.length(); i++)
-        if (isdigit(tokenString.at(i))) {
-          value = 1.0;
-        break;
-      }
-      index->setInfo(name,value);
+      if (checkIndex->getShape()&SHAPE_DIGIT)
+        value = 1.0;
+      index->setInfo(containDigitInfo,value);
     }
   }
   FeatureValue res(_alias,value);
   return res;
 }
 
+// the value is stored in the current token rather than in the token at the
+// context, so it depends on the order the tokens are seen in
+bool
+ContainDigit::isShiftable() const {
+  return false;
+}
+
 TwoDigits::TwoDigits(const int& context,
     const StringXML alias)
     : FeatureValueExtractor("TwoDigits",context,alias) {
@@ -395,18 +407,16 @@ TwoDigits::operator()(vector<TokenDeco>& tokens,
     const vector<TokenDeco>::iterator index,
     const StringXML& text) const {
   double value = 0.0;
-  StringXML name = "twoDigits";
   vector<TokenDeco>::iterator checkIndex=index;
   // if able to increment/decrement
   if (incrementIterator(tokens,checkIndex,_context)&&checkIndex!=tokens.end()) {
     // compute if not already computed
-    if (!checkIndex->getInfo(name,value)) {
-      StringXML tokenString = checkIndex->getString(text);
-      //Check 3 conditions: length is 2, and both characters are digits   
-      if (tokenString.length() == 2 && isdigit(tokenString.at(0))
-          && isdigit(tokenString.at(1)))
+    if (!checkIndex->getInfo(twoDigitsInfo,value)) {
+      //Check 2 conditions: length is 2, and both characters are digits   
+      if (checkIndex->getLength() == 2
+          && (checkIndex->getShape()&SHAPE_ALL_DIGITS))
         value = 1.0;
-      checkIndex->setInfo(name,value);
+      checkIndex->setInfo(twoDigitsInfo,value);
     }
   }
   FeatureValue res(_alias,value);
@@ -431,19 +441,16 @@ FourDigits::operator()(vector<TokenDeco>& tokens,
     const vector<TokenDeco>::iterator index,
     const StringXML& text) const {
   double value = 0.0;
-  StringXML name = "fourDigits";
   vector<TokenDeco>::iterator checkIndex=index;
   // if able to increment/decrement
   if (incrementIterator(tokens,checkIndex,_context)&&checkIndex!=tokens.end()) {
     // compute if not already computed
-    if (!checkIndex->getInfo(name,value)) {
-      StringXML tokenString = checkIndex->getString(text);
-      //Check 5 conditions: length is 4, and all characters are digits  
-      if (tokenString.length() == 4 && isdigit(tokenString.at(0))
-          && isdigit(tokenString.at(1))
-          && isdigit(tokenString.at(2)) && isdigit(tokenString.at(3)))
+    if (!checkIndex->getInfo(fourDigitsInfo,value)) {
+      //Check 2 conditions: length is 4, and all characters are digits  
+      if (checkIndex->getLength() == 4
+          && (checkIndex->getShape()&SHAPE_ALL_DIGITS))
         value = 1.0;
-      checkIndex->setInfo(name,value);
+      checkIndex->setInfo(fourDigitsInfo,value);
     }
   }
   FeatureValue res(_alias,value);
@@ -468,24 +475,19 @@ MonthName::operator()(vector<TokenDeco>& tokens,
     const vector<TokenDeco>::iterator index,
     const StringXML& text) const {
   double value = 0.0;
-  StringXML name = "monthName";
   vector<TokenDeco>::iterator checkIndex=index;
   // if able to increment/decrement
   if (incrementIterator(tokens,checkIndex,_context)&&checkIndex!=tokens.end()) {
     // compute if not already computed
-    if (!checkIndex->getInfo(name,value)) {
-      StringXML tokenString = checkIndex->getString(text);
-      //Make case a non-issue
-      tokenString.at(0) = toupper(tokenString.at(0));
-      //Check for any matches
-      if (tokenString == "January" || tokenString == "February"
-          || tokenString == "March" || tokenString == "April"
-          || tokenString == "May" || tokenString == "June"
-          || tokenString == "July" || tokenString == "August"
-          || tokenString == "September" || tokenString == "October"
-          || tokenString == "November" || tokenString == "December")
+    if (!checkIndex->getInfo(monthNameInfo,value)) {
+      TokenView tokenString = checkIndex->getView(text);
+      static const char* const months[]={"January","February","March",
+          "April","May","June","July","August","September","October",
+          "November","December",0};
+      //Check for any matches, case of the first letter a non-issue
+      if (capitalisedIn(tokenString,months))
         value = 1.0;
-      checkIndex->setInfo(name,value);
+      checkIndex->setInfo(monthNameInfo,value);
     }
   }
   FeatureValue res(_alias,value);
@@ -510,22 +512,18 @@ DayOfTheWeek::operator()(vector<TokenDeco>& tokens,
     const vector<TokenDeco>::iterator index,
     const StringXML& text) const {
   double value = 0.0;
-  StringXML name = "dayOfTheWeek";
   vector<TokenDeco>::iterator checkIndex=index;
   // if able to increment/decrement
   if (incrementIterator(tokens,checkIndex,_context)&&checkIndex!=tokens.end()) {
     // compute if not already computed
-    if (!checkIndex->getInfo(name,value)) {
-      StringXML tokenString = checkIndex->getString(text);
-      //Make case a non-issue
-      tokenString.at(0) = toupper(tokenString.at(0));
-      //Check for any matches 
-      if (tokenString == "Sunday" || tokenString == "Monday"
-          || tokenString == "Tuesday" || tokenString == "Wednesday"
-          || tokenString == "Thursday" || tokenString == "Friday"
-          || tokenString == "Saturday")
+    if (!checkIndex->getInfo(dayOfTheWeekInfo,value)) {
+      TokenView tokenString = checkIndex->getView(text);
+      static const char* const days[]={"Sunday","Monday","Tuesday",
+          "Wednesday","Thursday","Friday","Saturday",0};
+      //Check for any matches, case of the first letter a non-issue
+      if (capitalisedIn(tokenString,days))
         value = 1.0;
-      checkIndex->setInfo(name,value);
+      checkIndex->setInfo(dayOfTheWeekInfo,value);
     }
   }
   FeatureValue res(_alias,value);
@@ -550,35 +548,22 @@ NumberString::operator()(vector<TokenDeco>& tokens,
     const vector<TokenDeco>::iterator index,
     const StringXML& text) const {
   double value = 0.0;
-  StringXML name = "numberString";
   vector<TokenDeco>::iterator checkIndex=index;
   // if able to increment/decrement
   if (incrementIterator(tokens,checkIndex,_context)&&checkIndex!=tokens.end()) {
     // compute if not already computed
-    if (!checkIndex->getInfo(name,value)) {
-      StringXML tokenString = checkIndex->getString(text);
-      //Make case a non-issue
-      tokenString.at(0) = toupper(tokenString.at(0));
-      //Check for any matches   
-      if (tokenString == "One" || tokenString == "Two"
-          || tokenString == "Three" || tokenString == "Four"
-          || tokenString == "Five" || tokenString == "Six"
-          || tokenString == "Seven" || tokenString == "Eight"
-          || tokenString == "Nine" || tokenString == "Ten"
-          || tokenString == "Eleven" || tokenString == "Twelve"
-          || tokenString == "Thirteen" || tokenString == "Fourteen"
-          || tokenString == "Fifteen" || tokenString == "Sixteen"
-          || tokenString == "Seventeen" || tokenString == "Eighteen"
-          || tokenString == "Nineteen" || tokenString == "Twenty"
-          || tokenString == "Thirty" || tokenString == "Fourty"
-          || tokenString == "Fifty" || tokenString == "Sixty"
-          || tokenString == "Seventy" || tokenString == "Eighty"
-          || tokenString == "Ninety" || tokenString == "Hundred"
-          || tokenString == "Thousand" || tokenString == "Million"
-          || tokenString == "Billion" || tokenString == "Trillion"
-          || tokenString == "Quadrillion" || tokenString == "Quintillion")
+    if (!checkIndex->getInfo(numberStringInfo,value)) {
+      TokenView tokenString = checkIndex->getView(text);
+      static const char* const numbers[]={"One","Two","Three","Four",
+          "Five","Six","Seven","Eight","Nine","Ten","Eleven","Twelve",
+          "Thirteen","Fourteen","Fifteen","Sixteen","Seventeen","Eighteen",
+          "Nineteen","Twenty","Thirty","Fourty","Fifty","Sixty","Seventy",
+          "Eighty","Ninety","Hundred","Thousand","Million","Billion",
+          "Trillion","Quadrillion","Quintillion",0};
+      //Check for any matches, case of the first letter a non-issue
+      if (capitalisedIn(tokenString,numbers))
         value = 1.0;
-      checkIndex->setInfo(name,value);
+      checkIndex->setInfo(numberStringInfo,value);
     }
   }
   FeatureValue res(_alias,value);
@@ -604,29 +589,25 @@ PrepPreceded::operator()(vector<TokenDeco>& tokens,
     const vector<TokenDeco>::iterator index,
     const StringXML& text) const {
   double value = 0.0;
-  StringXML name = "prepPreceded";
   vector<TokenDeco>::iterator checkIndex=index;
   // if able to increment/decrement
   if (incrementIterator(tokens,checkIndex,_context)&&checkIndex!=tokens.end()) {
     // compute if not already computed
-    if (!checkIndex->getInfo(name,value)) {
-      StringXML tokenString = checkIndex->getString(text);
+    if (!checkIndex->getInfo(prepPrecededInfo,value)) {
+      static const char* const prepositions[]={"In","On","At",0};
       vector<TokenDeco>::iterator check_index = checkIndex;
       //Check the previous 4 tokens (if possible)
       for (unsigned int i = 0; i < 4; i++){
         if (check_index == tokens.begin())
           break;
         check_index--;
-        StringXML checkString = check_index->getString(text);
-        //Make case a non-issue
-        checkString.at(0) = toupper(checkString.at(0));
-        //Check for matches
-        if (checkString == "In" || checkString == "On" || checkString == "At"){
+        //Check for matches, case of the first letter a non-issue
+        if (capitalisedIn(check_index->getView(text),prepositions)){
           value = 1.0;
           break;
         }
       }
-      checkIndex->setInfo(name,value);
+      checkIndex->setInfo(prepPrecededInfo,value);
     }
   }
   FeatureValue res(_alias,value);
@@ -645,72 +626,60 @@ AlwaysCapped::AlwaysCapped(const int& context,const StringXML alias)
   _alias = ss.str();
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// 'indexCapped' sets AlwaysCapped in every token, in one pass: 1 if every
+// token of the text that is the same word, ignoring case, starts with a
+// capital, 0 otherwise.  The words are indexed lower cased, with whether all
+// their tokens are capitalised so far.
+////////////////////////////////////////////////////////////////////////////////
+static void
+indexCapped(vector<TokenDeco>& tokens,const StringXML& text) {
+  typedef __gnu_cxx::hash_map<StringXML,bool,hash_str> CappedIndex;
+  CappedIndex capped;
+  // the flag of the word of each token
+  vector<const bool*> words;
+  words.reserve(tokens.size());
+  StringXML word;
+  for (vector<TokenDeco>::const_iterator ite=tokens.begin();
+      ite!=tokens.end();ite++) {
+    TokenView view = ite->getView(text);
+    word.assign(view.begin(),view.end());
+    for (StringXML::iterator c=word.begin();c!=word.end();c++) {
+      *c = tolower(static_cast<unsigned char>(*c));
+    }
+    pair<CappedIndex::iterator,bool> found =
+        capped.insert(make_pair(word,true));
+    if (!(ite->getShape()&SHAPE_INIT_CAP)) {
+      found.first->second = false;
+    }
+    words.push_back(&found.first->second);
+  }
+  for (vector<TokenDeco>::iterator ite=tokens.begin();
+      ite!=tokens.end();ite++) {
+    ite->setInfo(alwaysCappedInfo,*words[ite-tokens.begin()] ? 1.0 : 0.0);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The value is 1 if the token is capitalised every time its word appears in
+// the text, ignoring case.  It used to compare any two tokens of the same
+// length as the same word, and never found a token always capitalised, so
+// the value was always 0; models trained before give the feature no weight.
+////////////////////////////////////////////////////////////////////////////////
 FeatureValue
 AlwaysCapped::operator()(vector<TokenDeco>& tokens,
     const vector<TokenDeco>::iterator index,
     const StringXML& text) const {
   double value=0.0;
-  StringXML name="alwaysCapped";
   vector<TokenDeco>::iterator checkIndex=index;
   // if able to increment/decrement
   if (incrementIterator(tokens,checkIndex,_context)&&checkIndex!=tokens.end()) {
-    // compute if not already computed
-    if (!checkIndex->getInfo(name,value)) {
-      // check status of current token, then check sequentially, adding
-      // tokens to change to list to modify later
-      double cV = 1.0;
-      // compute InitCaps if not already done
-      if (!checkIndex->getInfo("initCaps",cV)) {
-        InitCaps IC;
-        FeatureValue fv = IC(tokens,checkIndex,text);
-        cV = fv.getValue();
-      }
-      // initialise to capped status of index
-      bool foundSmall = (cV==0.0);
-      // a vector to store terators to the same tokens
-      vector<vector<TokenDeco>::iterator> sameToks;
-      // for each token
-      sameToks.push_back(checkIndex);
-      for (vector<TokenDeco>::iterator ite=tokens.begin();
-            ite!=tokens.end()&&!foundSmall;ite++) {
-        // if words are the same
-        StringXML a = checkIndex->getString(text);
-        StringXML b = ite->getString(text);
-        if (a.length()==b.length()){
-          for (unsigned int i=0;i<a.length();i++){
-            a[i] = tolower(a[i]);
-            b[i] = tolower(a[i]);
-          }
-        }
-        if (a==b) {
-          // if value has been computed, exit loop store all
-          if (ite->getInfo(name,value)) {
-            break;
-          }
-          // otherwise add to list to update
-          else{
-            sameToks.push_back(ite);
-          }
-          double checkVal=1.0;
-          // compute if value for current has not been computed
-          if (!ite->getInfo("initCaps",checkVal)) {
-            InitCaps IC;
-            FeatureValue fv = IC(tokens,ite,text);
-            checkVal = fv.getValue();
-          }
-          // check if current is capitalised, true if is lower
-          foundSmall = (checkVal==0.0);
-        }
-      }
-      if (foundSmall)
-        value=0.0;
-      for (vector<vector<TokenDeco>::iterator>::const_iterator ite=sameToks.begin();
-            ite!=sameToks.end();ite++){
-        (**ite).setInfo(name,value);
-      }
+    // the first time in a text, compute the value of every token
+    if (!checkIndex->getInfo(alwaysCappedInfo,value)) {
+      indexCapped(tokens,text);
+      checkIndex->getInfo(alwaysCappedInfo,value);
     }
   }
-  // value has been computed at this point
   FeatureValue res(_alias,value);
   return res;
 }
@@ -725,6 +694,10 @@ FoundInList::FoundInList(const ListHandler* lh, const int list,
   stringstream ss1;
   ss1 << _feature_name << _list;
   //_feature_name = ss1.str();
+  for (int i=0;i<_list_handler->ListCount();i++) {
+    _listsInfo.push_back(InfoRegistry::slot("FoundList",i));
+  }
+  _info=InfoRegistry::slot("FoundList",_list);
 }
 
 StringXML
@@ -746,46 +719,89 @@ FoundInList::operator()(vector<TokenDeco>& tokens,
     const vector<TokenDeco>::iterator index,
     const StringXML& text) const {
   double value=0.0;
-  stringstream ss;
-  ss << "FoundList" << _list;
-  StringXML name = ss.str();
   vector<TokenDeco>::iterator checkIndex=index;
   // if able to increment compute value for token indicated by context
   if (incrementIterator(tokens,checkIndex,_context)&&checkIndex!=tokens.end()) {
     // if search not done
-    if (!checkIndex->getInfo(name,value)) {
+    if (!checkIndex->getInfo(_info,value)) {
       // for each list in the ListHandler, set not found
-      for (int i=0;i<_list_handler->ListCount();i++) {
-        stringstream ss2;
-        ss2 << "FoundList" << i;
-        checkIndex->setInfo(ss2.str(),0.0);
+      for (vector<int>::const_iterator i=_listsInfo.begin();
+          i!=_listsInfo.end();i++) {
+        checkIndex->setInfo(*i,0.0);
       }
       // perform the search, update TokenDeco
       vector<int> results = 
           _list_handler->FindString(checkIndex->getString(text));
       for (vector<int>::const_iterator ite=results.begin();
           ite!=results.end();ite++) {
-        stringstream ss2;
-        ss2 << "FoundList" << *ite;
-        checkIndex->setInfo(ss2.str(),1.0);
+        if (*ite>=0 && *ite<static_cast<int>(_listsInfo.size())) {
+          checkIndex->setInfo(_listsInfo[*ite],1.0);
+        }
+        else {
+          checkIndex->setInfo(InfoRegistry::slot("FoundList",*ite),1.0);
+        }
       } // finished updating decorator
     } // end if search not done
-    checkIndex->getInfo(name,value);
+    checkIndex->getInfo(_info,value);
   } // end if able to increment
   FeatureValue res(_alias,value);
   return res;
 }
 
-MatchRegex::MatchRegex(const StringXML& regex_name,const boost::regex& regex,
-    const int& context,const StringXML alias)
+RegexFeatures::RegexFeatures(const vector<boost::regex>& regexes)
+    :_regexes(regexes) {
+  for (size_t j=0;j<_regexes.size();j++) {
+    _prefilters.push_back(RegexPrefilter());
+    _prefilters.back().build(_regexes[j].str(),
+        (_regexes[j].flags()&boost::regex::icase)!=0);
+    _infoSlots.push_back(InfoRegistry::slot("mRX",j));
+  }
+}
+
+void
+RegexFeatures::match(const StringXML& token,vector<bool>& matched) const {
+  {
+    boost::mutex::scoped_lock lock(_cacheLock);
+    MatchCache::const_iterator cached=_cache.find(token);
+    if (cached!=_cache.end()) {
+      matched=cached->second;
+      return;
+    }
+  }
+  matched.assign(_regexes.size(),false);
+  for (size_t j=0;j<_regexes.size();j++) {
+    cmatch what;
+    matched[j]=_prefilters[j].mayMatch(token.data(),
+        token.data()+token.size()) &&
+        regex_match(token.c_str(),what,_regexes[j]);
+  }
+  boost::mutex::scoped_lock lock(_cacheLock);
+  if (_cache.size()>=maxCached) {
+    _cache.clear();
+  }
+  _cache[token]=matched;
+}
+
+size_t
+RegexFeatures::size() const {
+  return _regexes.size();
+}
+
+int
+RegexFeatures::infoSlot(const size_t j) const {
+  return _infoSlots[j];
+}
+
+MatchRegex::MatchRegex(const boost::shared_ptr<const RegexFeatures>& regexes,
+    const size_t index,const int& context,const StringXML alias)
     : FeatureValueExtractor("MatchRegex",context,alias),
-    _regex_name(regex_name),_regex(regex) {
+    _regexes(regexes),_index(index) {
   stringstream ss;
   if (_alias!="") {
-    ss << _alias << _regex_name << "_" << context;
+    ss << _alias << _index << "_" << context;
   }
   else {
-    ss << _feature_name << _regex_name << "_" << context;
+    ss << _feature_name << _index << "_" << context;
   }
   _alias = ss.str();
 }
@@ -794,22 +810,20 @@ FeatureValue
 MatchRegex::operator()(vector<TokenDeco>& tokens,
     const vector<TokenDeco>::iterator index,
     const StringXML& text) const {
-  StringXML name = "mRX" + _regex_name;
+  const int info = _regexes->infoSlot(_index);
   double value = 0.0;
   vector<TokenDeco>::iterator checkIndex=index;
   // if can increment and not at end
   if (incrementIterator(tokens,checkIndex,_context)&&
       checkIndex!=tokens.end()) {
-    // if not found, compute and add to decorator
-    if (!checkIndex->getInfo(name,value)) {
-       StringXML tok = checkIndex->getString(text);
-       cmatch what;
-       // if matches the regular expression
-       if (regex_match(tok.c_str(),what,_regex)) {
-         // set the value and record in deco
-         value = 1.0;
-         checkIndex->setInfo(name,value);
-       }
+    // if not found, compute all the expressions and add to decorator
+    if (!checkIndex->getInfo(info,value)) {
+      vector<bool> matched;
+      _regexes->match(checkIndex->getString(text),matched);
+      for (size_t j=0;j<matched.size();j++) {
+        checkIndex->setInfo(_regexes->infoSlot(j),matched[j]?1.0:0.0);
+      }
+      value = matched[_index]?1.0:0.0;
     }
   }
   FeatureValue res(_alias,value);
@@ -819,7 +833,7 @@ MatchRegex::operator()(vector<TokenDeco>& tokens,
 PartMatch::PartMatch(const StringXML& info_name, const int& context,
     const StringXML alias)
     : FeatureValueExtractor("PartMatch",context,alias)
-        ,_info_name(info_name) {
+        ,_info_name(info_name),_info(InfoRegistry::slot(info_name)) {
   stringstream ss;
   if (_alias!="") {
     ss << _alias << _info_name << "_" << _context;
@@ -834,13 +848,12 @@ FeatureValue
 PartMatch::operator()(vector<TokenDeco>& tokens,
     const vector<TokenDeco>::iterator index,
     const StringXML& text) const {
-  StringXML name = _info_name;
   double value = 0;
   vector<TokenDeco>::iterator checkIndex=index;
   // if can increment and not at end
   if (incrementIterator(tokens,checkIndex,_context)&&
       checkIndex!=tokens.end()) {
-    if (checkIndex->getInfo(_info_name,value)) {
+    if (checkIndex->getInfo(_info,value)) {
       value=1.0;
     }
   }
@@ -850,7 +863,8 @@ PartMatch::operator()(vector<TokenDeco>& tokens,
 
 PrevClass::PrevClass(const int checkClass,const int& context,
     const StringXML alias) 
-  : FeatureValueExtractor("PrevClass",context,alias),_checkClass(checkClass) {
+  : FeatureValueExtractor("PrevClass",context,alias),_checkClass(checkClass),
+    _probInfo(InfoRegistry::slot("prob",checkClass)) {
   stringstream ss1;
   if (_alias!="") {
     ss1 << _alias << _checkClass << "_" << _context;
@@ -879,15 +893,12 @@ PrevClass::operator()(vector<TokenDeco>& tokens,
         checkIndex--;
         // if has been classified
         // get the previous class
-        if (checkIndex->getInfo("maxProb",value)) {
+        if (checkIndex->getInfo(maxProbInfo,value)) {
           int prevClass = static_cast<int>(value);
           // if the class is what we are looking for, then set value
           if (prevClass==_checkClass) {
-            stringstream ss;
-            ss << "prob" << prevClass;
             // get the probability
-            name = ss.str();
-            checkIndex->getInfo(name,value);
+            checkIndex->getInfo(_probInfo,value);
           }
           // otherwise, set the value (prob) to 0
           else {
@@ -907,10 +918,22 @@ PrevClass::operator()(vector<TokenDeco>& tokens,
   return res;
 }
 
+// the previous class is only known once the previous token is classified
+bool
+PrevClass::usesClassification() const {
+  return true;
+}
+
+bool
+PrevClass::isShiftable() const {
+  return false;
+}
+
 ProbClass::ProbClass(const int classification,
     const int& context,const StringXML alias)
     : FeatureValueExtractor("ProbClass",context,alias),
-    _classification(classification) {
+    _classification(classification),
+    _probInfo(InfoRegistry::slot("prob",classification)) {
   stringstream ss1;
   if (_alias!="") {
     ss1 << _alias << _classification << "_" << _context;
@@ -926,9 +949,6 @@ ProbClass::operator()(vector<TokenDeco>& tokens,
     const vector<TokenDeco>::iterator index,
     const StringXML& text) const {
   // retrieve the probability
-  stringstream ss;
-  ss << "prob" << _classification;
-  StringXML name = ss.str();
   double value = 0;
   vector<TokenDeco>::iterator checkIndex=index;
   // if able to increment compute value for token indicated
@@ -937,13 +957,24 @@ ProbClass::operator()(vector<TokenDeco>& tokens,
      // get the classification
      if (checkIndex != tokens.begin()) {
        checkIndex--;
-       checkIndex->getInfo(name,value);
+       checkIndex->getInfo(_probInfo,value);
      }
   }
   FeatureValue res(_alias,value);
   return res; 
 }
 
+// the probabilities are only known once the previous token is classified
+bool
+ProbClass::usesClassification() const {
+  return true;
+}
+
+bool
+ProbClass::isShiftable() const {
+  return false;
+}
+
 TokenFrequency::TokenFrequency(const int classification,
     const FrequencyHandler* frequencies,
     const int& context,const StringXML alias)
@@ -964,9 +995,6 @@ TokenFrequency::operator()(vector<TokenDeco>& tokens,
     const vector<TokenDeco>::iterator index,
     const StringXML& text) const {
   // retrieve the probability
-  stringstream ss;
-  ss << "prob" << _classification;
-  StringXML name = ss.str();
   double value = 0;
   vector<TokenDeco>::iterator checkIndex=index;
   // if able to increment compute value for token indicated
@@ -1002,9 +1030,6 @@ PrevTokenFrequency::operator()(vector<TokenDeco>& tokens,
     const vector<TokenDeco>::iterator index,
     const StringXML& text) const {
   // retrieve the probability
-  stringstream ss;
-  ss << "prob" << _classification;
-  StringXML name = ss.str();
   double value = 0;
   vector<TokenDeco>::iterator checkIndex=index;
   // if able to increment compute value for token indicated
@@ -31,11 +31,15 @@
 #include <vector>
 #include <string>
 #include <boost/regex.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <ext/hash_map>
 #include "tokeniser.h"
 #include "feature_extraction.h"
 #include "list_handler.h"
 #include "ner.h"
 #include "suffixtree.h"
+#include "regex_scanner.h"
 #include "xml_string.h"
 
 using namespace std;
@@ -72,6 +76,46 @@ private:
 };
 
 
+////////////////////////////////////////////////////////////////////////////////
+// The RegexFeatures class holds the feature regular expressions, matched
+// against whole tokens.  Which of them each token string matches is cached,
+// so that every distinct string is matched once per run.  The cache is
+// shared by all the threads.
+////////////////////////////////////////////////////////////////////////////////
+class RegexFeatures {
+public:
+  RegexFeatures(const vector<boost::regex>& regexes);
+
+////////////////////////////////////////////////////////////////////////////////
+// 'match' sets matched[j] to whether 'token' matches the j-th expression
+////////////////////////////////////////////////////////////////////////////////
+  void
+  match(const StringXML& token,vector<bool>& matched) const;
+
+  size_t
+  size() const;
+
+////////////////////////////////////////////////////////////////////////////////
+// 'infoSlot' returns the slot of the token information recording whether
+// the token matches the j-th expression
+////////////////////////////////////////////////////////////////////////////////
+  int
+  infoSlot(const size_t j) const;
+
+private:
+  // the cache is emptied when it has more strings than this
+  static const size_t maxCached=1<<20;
+
+  typedef __gnu_cxx::hash_map<StringXML,vector<bool>,hash_str> MatchCache;
+
+  vector<boost::regex> _regexes;
+  // the literals a token must have to match each expression
+  vector<RegexPrefilter> _prefilters;
+  vector<int> _infoSlots;
+  mutable MatchCache _cache;
+  mutable boost::mutex _cacheLock;
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 // 'operator()()' computes the FeatureValue.  It works on tokens and
 // computes the value of a feature of the particular index. Each class is made
@@ -162,6 +206,9 @@ public:
   operator()(vector<TokenDeco>& tokens,
       const vector<TokenDeco>::iterator index,
       const StringXML& text) const;
+
+  bool
+  isShiftable() const;
 private:
 }; // OneCap
 
@@ -175,6 +222,9 @@ public:
   operator()(vector<TokenDeco>& tokens,
       const vector<TokenDeco>::iterator index,
       const StringXML& text) const;
+
+  bool
+  isShiftable() const;
 private:
 }; // ContainDigit
 
@@ -293,20 +343,28 @@ private:
   const ListHandler* _list_handler;
   // the index of the list to search
   const int _list;
+  // the slots of the results for every list, and for this one
+  vector<int> _listsInfo;
+  int _info;
 };
 
+////////////////////////////////////////////////////////////////////////////////
+// Finds whether the token matches the 'index'-th feature regular expression.
+// The first time a token is looked at, whether it matches each of the
+// expressions is recorded in the token.
+////////////////////////////////////////////////////////////////////////////////
 class MatchRegex : public FeatureValueExtractor {
 public:
-  MatchRegex(const StringXML& regex_name,const boost::regex& regex,
-      const int& context=0,const StringXML alias="");
+  MatchRegex(const boost::shared_ptr<const RegexFeatures>& regexes,
+      const size_t index,const int& context=0,const StringXML alias="");
   
   FeatureValue
   operator()(vector<TokenDeco>& tokens,
       const vector<TokenDeco>::iterator index,
       const StringXML& text) const;
 private:
-  StringXML _regex_name;
-  const boost::regex _regex;
+  const boost::shared_ptr<const RegexFeatures> _regexes;
+  const size_t _index;
 };
 
 class PartMatch : public FeatureValueExtractor {
@@ -325,6 +383,7 @@ public:
 
 private:
   const StringXML _info_name;
+  const int _info;
 };
 
 class PrevClass : public FeatureValueExtractor {
@@ -337,8 +396,16 @@ public:
       const vector<TokenDeco>::iterator index,
       const StringXML& text) const;
 
+  bool
+  usesClassification() const;
+
+  bool
+  isShiftable() const;
+
 private:
   const int _checkClass;
+  // the slot of the probability of the class
+  const int _probInfo;
 };
 
 class ProbClass : public FeatureValueExtractor {
@@ -351,8 +418,16 @@ public:
       const vector<TokenDeco>::iterator index,
       const StringXML& text) const;
 
+  bool
+  usesClassification() const;
+
+  bool
+  isShiftable() const;
+
 private:
   const int _classification;
+  // the slot of the probability of the class
+  const int _probInfo;
 };
 
 class TokenFrequency : public FeatureValueExtractor {
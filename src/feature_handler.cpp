@@ -81,8 +81,14 @@ FeatureHandler::GetFeatureDetectionAlgorithms(const ListHandler& lh,
     const double default_weight,const StringXML& freqFile,
     const StringXML& prevFreqFile) const {
   vector<FeatureValueExtractor*> vec;
+  // the feature regular expressions, shared by their extractors
+  boost::shared_ptr<const RegexFeatures> regexes(
+      new RegexFeatures(regex_list));
+  // the position of the first extractor of each context
+  vector<size_t> blocks;
   // for the contextual range before and after token
   for (int i=(-1*context);i<(context+1);i++) {
+    blocks.push_back(vec.size());
     vec.push_back(new InitCaps(i,"IC"));
     vec.push_back(new AllCaps(i,"AC"));
     vec.push_back(new MixedCaps(i,"MC"));
@@ -110,18 +116,13 @@ FeatureHandler::GetFeatureDetectionAlgorithms(const ListHandler& lh,
     }
 
     // for each regex in the feature specific list regex_list
-    int j=0;
-    for (vector<boost::regex>::const_iterator ite=regex_list.begin();
-        ite!=regex_list.end();ite++) {
-      stringstream ss;
-      ss << j;
+    for (size_t j=0;j<regexes->size();j++) {
       // add a feature for the match
-      vec.push_back(new MatchRegex(ss.str(),*ite,i,"MRX"));
-      j++;
+      vec.push_back(new MatchRegex(regexes,j,i,"MRX"));
     }
     
     // for each regex in the RegexHandler
-    j = 0;
+    int j = 0;
     for (map<regex,EntityTag>::const_iterator ite=rh.begin();
         ite!=rh.end();ite++) {
       // matching tokens are marked with "regex$"
@@ -147,6 +148,19 @@ FeatureHandler::GetFeatureDetectionAlgorithms(const ListHandler& lh,
       }
     }
   } // end contextual features
+  blocks.push_back(vec.size());
+  // the same extractors are made for each context, so those that can read
+  // the values of the extractor with context 0 at the same position
+  const size_t zero=blocks[context];
+  for (size_t b=0;b+1<blocks.size();b++) {
+    for (size_t k=blocks[b];k<blocks[b+1];k++) {
+      const size_t base=zero+k-blocks[b];
+      if (vec[k]->isShiftable() && base<blocks[context+1] &&
+          vec[k]->getName()==vec[base]->getName()) {
+        vec[k]->setShiftOf(base);
+      }
+    }
+  }
   // for each class
   for (int c=0;c<tset.classCount();c++) {
       vec.push_back(new PrevClass(c,0,"PC"));
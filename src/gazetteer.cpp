@@ -0,0 +1,690 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: gazetteer.cpp
+////////////////////////////////////////////////////////////////////////////////
+// This file contains the implementation of the Gazetteer class, an
+// Aho-Corasick automaton over the tokens of the entries of the entity lists.
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2008  Diego Molla-Aliod <diego@ics.mq.edu.au>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <map>
+#include <deque>
+#include <utility>
+#include <algorithm>
+#include <fstream>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "gazetteer.h"
+#include "tokeniser.h"
+#include "tokenDeco.h"
+#include "xml_string.h"
+
+using namespace std;
+using namespace AF;
+
+////////////////////////////////////////////////////////////////////////////////
+// INDEX FILE FORMAT
+// A header, a stamp for each list file the gazetteer was built from, the
+// tables of the automaton and the strings.  The children of state s are the
+// edges edgeStart[s] to edgeStart[s+1]-1, sorted by symbol, and the lists it
+// is an entry of are lists[listStart[s]] to lists[listStart[s+1]-1].  The
+// token and gap (text between tokens) strings are sorted, string i running
+// from offset[i] to offset[i+1] in the string table, with symbol id ids[i].
+// Every section starts at a multiple of 8 bytes.  Numbers are stored in the
+// byte order of the machine that wrote the file.  A compiled gazetteer is
+// kept in memory in the same layout.
+////////////////////////////////////////////////////////////////////////////////
+static const char indexMagic[8]={'A','F','N','E','R','G','Z','I'};
+static const uint32_t indexVersion=1;
+static const uint32_t indexByteOrder=0x01020304;
+
+enum {
+  STAMPS,EDGE_START,EDGE_SYMBOL,EDGE_TARGET,LIST_START,LISTS,FAIL,OUTPUT,
+  LENGTH,TOKEN_OFFSETS,TOKEN_IDS,GAP_OFFSETS,GAP_IDS,STRINGS,SECTIONS
+};
+
+struct GazetteerHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint64_t sources;  // number of list files
+  uint64_t states;
+  uint64_t edges;
+  uint64_t lists;    // number of (state, list) entries
+  uint64_t tokens;
+  uint64_t gaps;
+  uint64_t strings;  // size of the string table
+  uint64_t section[SECTIONS];  // offset of each section
+  uint64_t size;     // size of the file
+};
+
+// a list file: its modification time, size, contents hash and name
+struct SourceStamp {
+  int64_t time;
+  uint64_t size;
+  uint64_t hash;
+  uint64_t name;        // offset in the string table
+  uint64_t nameLength;
+};
+
+static uint64_t
+align8(const uint64_t offset) {
+  return (offset+7)&~static_cast<uint64_t>(7);
+}
+
+// the size in bytes of each section of an index with the counts given
+static void
+sectionSizes(const GazetteerHeader& h,uint64_t sizes[SECTIONS]) {
+  sizes[STAMPS]=h.sources*sizeof(SourceStamp);
+  sizes[EDGE_START]=(h.states+1)*sizeof(int32_t);
+  sizes[EDGE_SYMBOL]=h.edges*sizeof(int32_t);
+  sizes[EDGE_TARGET]=h.edges*sizeof(int32_t);
+  sizes[LIST_START]=(h.states+1)*sizeof(int32_t);
+  sizes[LISTS]=h.lists*sizeof(int32_t);
+  sizes[FAIL]=h.states*sizeof(int32_t);
+  sizes[OUTPUT]=h.states*sizeof(int32_t);
+  sizes[LENGTH]=h.states*sizeof(int32_t);
+  sizes[TOKEN_OFFSETS]=(h.tokens+1)*sizeof(uint64_t);
+  sizes[TOKEN_IDS]=h.tokens*sizeof(int32_t);
+  sizes[GAP_OFFSETS]=(h.gaps+1)*sizeof(uint64_t);
+  sizes[GAP_IDS]=h.gaps*sizeof(int32_t);
+  sizes[STRINGS]=h.strings;
+}
+
+// 'section' returns a pointer to section 'k' of an index
+template<class T>
+static const T*
+section(const char* data,const int k) {
+  const GazetteerHeader* h=reinterpret_cast<const GazetteerHeader*>(data);
+  return reinterpret_cast<const T*>(data+h->section[k]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 'stampSource' records the time, size and a hash (64 bit FNV-1a) of the
+// contents of a file; a file that cannot be read gets an empty stamp
+////////////////////////////////////////////////////////////////////////////////
+static void
+stampSource(const StringXML& file,SourceStamp& stamp,const bool hash=true) {
+  struct stat st;
+  stamp.time=-1;
+  stamp.size=0;
+  stamp.hash=0;
+  if (stat(file.c_str(),&st)==0) {
+    stamp.time=st.st_mtime;
+    stamp.size=st.st_size;
+  }
+  if (!hash) {
+    return;
+  }
+  uint64_t h=14695981039346656037ULL;
+  ifstream in(file.c_str(),ios::in|ios::binary);
+  char buffer[65536];
+  while (in) {
+    in.read(buffer,sizeof(buffer));
+    for (streamsize i=0;i<in.gcount();i++) {
+      h=(h^static_cast<unsigned char>(buffer[i]))*1099511628211ULL;
+    }
+  }
+  stamp.hash=h;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 'validIndex' checks that an index of 'size' bytes has a valid header, that
+// its sections lie in order inside it, and that its tables only refer to
+// states, edges, lists and strings that exist.  The states must form a tree
+// from the root with the edges of each state sorted by symbol, their entry
+// lengths must fit their depth, and failure and output links must lead to
+// shallower states, so that matching never loops or starts an entry before
+// the first token.
+////////////////////////////////////////////////////////////////////////////////
+static bool
+validIndex(const char* data,const uint64_t size) {
+  if (size<sizeof(GazetteerHeader)) {
+    return false;
+  }
+  GazetteerHeader h;
+  memcpy(&h,data,sizeof(h));
+  if ((memcmp(h.magic,indexMagic,sizeof(indexMagic))!=0)||
+      (h.version!=indexVersion)||(h.byteOrder!=indexByteOrder)||
+      (h.size!=size)||(h.states==0)||(h.states>0x7fffffffULL)||
+      (h.edges>0x7fffffffULL)||(h.lists>0x7fffffffULL)||(h.sources>size)||
+      (h.tokens>size)||(h.gaps>size)||(h.strings>size)) {
+    return false;
+  }
+  uint64_t sizes[SECTIONS];
+  sectionSizes(h,sizes);
+  uint64_t end=sizeof(h);
+  for (int k=0;k<SECTIONS;k++) {
+    if ((h.section[k]%8!=0)||(h.section[k]<end)||(h.section[k]>size)||
+        (sizes[k]>size-h.section[k])) {
+      return false;
+    }
+    end=h.section[k]+sizes[k];
+  }
+  const int32_t* edgeStart=section<int32_t>(data,EDGE_START);
+  const int32_t* edgeSymbol=section<int32_t>(data,EDGE_SYMBOL);
+  const int32_t* edgeTarget=section<int32_t>(data,EDGE_TARGET);
+  const int32_t* listStart=section<int32_t>(data,LIST_START);
+  const int32_t* lists=section<int32_t>(data,LISTS);
+  const int32_t* fail=section<int32_t>(data,FAIL);
+  const int32_t* output=section<int32_t>(data,OUTPUT);
+  const int32_t* length=section<int32_t>(data,LENGTH);
+  const int64_t states=h.states;
+  bool valid=(edgeStart[0]==0)&&(edgeStart[states]==int64_t(h.edges))&&
+      (listStart[0]==0)&&(listStart[states]==int64_t(h.lists));
+  for (int64_t s=0;valid&&(s<states);s++) {
+    valid=(edgeStart[s]<=edgeStart[s+1])&&(listStart[s]<=listStart[s+1])&&
+        (fail[s]>=0)&&(fail[s]<states)&&(output[s]>=-1)&&(output[s]<states);
+  }
+  for (uint64_t e=0;valid&&(e<h.edges);e++) {
+    valid=(edgeTarget[e]>0)&&(edgeTarget[e]<states);
+  }
+  for (int64_t s=0;valid&&(s<states);s++) {
+    for (int e=edgeStart[s]+1;valid&&(e<edgeStart[s+1]);e++) {
+      valid=(edgeSymbol[e-1]<edgeSymbol[e]);
+    }
+  }
+  for (uint64_t i=0;valid&&(i<h.lists);i++) {
+    valid=(lists[i]>=0)&&(lists[i]<int64_t(h.sources));
+  }
+  // the depth of each state in edges: every state but the root is the
+  // target of exactly one edge
+  vector<int64_t> depth(valid?states:0,-1);
+  deque<int> queue;
+  if (valid) {
+    depth[0]=0;
+    queue.push_back(0);
+  }
+  int64_t reached=0;
+  while (valid&&!queue.empty()) {
+    const int state=queue.front();
+    queue.pop_front();
+    reached++;
+    for (int e=edgeStart[state];valid&&(e<edgeStart[state+1]);e++) {
+      valid=(depth[edgeTarget[e]]<0);
+      depth[edgeTarget[e]]=depth[state]+1;
+      queue.push_back(edgeTarget[e]);
+    }
+  }
+  valid=valid&&(reached==states)&&(length[0]==0)&&(fail[0]==0)&&
+      (output[0]==-1)&&(listStart[0]==listStart[1]);
+  for (int64_t s=1;valid&&(s<states);s++) {
+    valid=(length[s]>=1)&&(length[s]<=(depth[s]+1)/2)&&
+        (depth[fail[s]]<depth[s])&&
+        ((output[s]<0)||(depth[output[s]]<depth[s]));
+  }
+  const uint64_t* offsets[2]={section<uint64_t>(data,TOKEN_OFFSETS),
+      section<uint64_t>(data,GAP_OFFSETS)};
+  const uint64_t counts[2]={h.tokens,h.gaps};
+  for (int t=0;valid&&(t<2);t++) {
+    for (uint64_t i=0;valid&&(i<counts[t]);i++) {
+      valid=(offsets[t][i]<=offsets[t][i+1])&&(offsets[t][i+1]<=h.strings);
+    }
+  }
+  const SourceStamp* stamps=section<SourceStamp>(data,STAMPS);
+  for (uint64_t i=0;valid&&(i<h.sources);i++) {
+    valid=(stamps[i].name<=h.strings)&&
+        (stamps[i].nameLength<=h.strings-stamps[i].name);
+  }
+  return valid;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 'upToDate' checks that a valid index was built from the list files given,
+// and that none of them has changed since
+////////////////////////////////////////////////////////////////////////////////
+static bool
+upToDate(const char* data,const vector<StringXML>& sources) {
+  const GazetteerHeader* h=reinterpret_cast<const GazetteerHeader*>(data);
+  if (h->sources!=sources.size()) {
+    return false;
+  }
+  const SourceStamp* stamps=section<SourceStamp>(data,STAMPS);
+  const char* strings=section<char>(data,STRINGS);
+  for (size_t i=0;i<sources.size();i++) {
+    if (StringXML(strings+stamps[i].name,stamps[i].nameLength)!=sources[i]) {
+      return false;
+    }
+    SourceStamp now;
+    stampSource(sources[i],now,false);
+    if ((now.time!=stamps[i].time)||(now.size!=stamps[i].size)) {
+      stampSource(sources[i],now);
+      if ((now.size!=stamps[i].size)||(now.hash!=stamps[i].hash)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 'splitEntry' splits a text into its tokens and the text between them, in
+// turn, as the tokeniser splits documents.  Returns false if the text does
+// not start and end with a token.
+////////////////////////////////////////////////////////////////////////////////
+static bool
+splitEntry(const StringXML& text,vector<StringXML>& parts) {
+  parts.clear();
+  vector<Token> tokens=tokenise(text.begin(),text.end());
+  if (tokens.empty() || tokens.front().getBegin()!=0 ||
+      tokens.back().getEnd()!=text.size()) {
+    return false;
+  }
+  for (vector<Token>::const_iterator t=tokens.begin();t!=tokens.end();t++) {
+    if (t!=tokens.begin()) {
+      parts.push_back(text.substr((t-1)->getEnd(),
+          t->getBegin()-(t-1)->getEnd()));
+    }
+    parts.push_back(t->getString(text));
+  }
+  return true;
+}
+
+// 'childOf' returns the child of 'state' by symbol 'id' in the edges given,
+// or -1
+static int
+childOf(const int32_t* edgeStart,const int32_t* edgeSymbol,
+    const int32_t* edgeTarget,const int state,const int id) {
+  const int32_t* b=edgeSymbol+edgeStart[state];
+  const int32_t* e=edgeSymbol+edgeStart[state+1];
+  const int32_t* c=lower_bound(b,e,id);
+  return (c!=e && *c==id)?edgeTarget[c-edgeSymbol]:-1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor: the automaton starts with the root state only
+////////////////////////////////////////////////////////////////////////////////
+Gazetteer::Gazetteer()
+    :_symbols(0),_children(1),_entryLists(1),_entryLength(1,0),
+    _mapped(0),_mappedSize(0),_states(0),_edgeStart(0),_edgeSymbol(0),
+    _edgeTarget(0),_listStart(0),_lists(0),_fail(0),_output(0),_length(0),
+    _tokenCount(0),_tokenOffsets(0),_tokenIds(0),_gapCount(0),
+    _gapOffsets(0),_gapIds(0),_strings(0) {
+}
+
+Gazetteer::~Gazetteer() {
+  if (_mapped) {
+    munmap(_mapped,_mappedSize);
+  }
+}
+
+void
+Gazetteer::add(const StringXML& entry,const int list) {
+  vector<StringXML> parts;
+  if (!splitEntry(entry,parts)) {
+    return;
+  }
+  int state=0;
+  for (unsigned int i=0;i<parts.size();i++) {
+    // even parts are tokens, odd parts the text between them
+    SymbolTable& table=(i%2==0)?_tokens:_gaps;
+    SymbolTable::const_iterator s=table.find(parts[i]);
+    int id;
+    if (s==table.end()) {
+      id=_symbols++;
+      table[parts[i]]=id;
+    }
+    else {
+      id=s->second;
+    }
+    map<int,int>::const_iterator c=_children[state].find(id);
+    if (c!=_children[state].end()) {
+      state=c->second;
+    }
+    else {
+      const int created=_children.size();
+      _children[state][id]=created;
+      _children.push_back(map<int,int>());
+      _entryLists.push_back(vector<int>());
+      _entryLength.push_back(i/2+1);
+      state=created;
+    }
+  }
+  vector<int>& lists=_entryLists[state];
+  if (std::find(lists.begin(),lists.end(),list)==lists.end()) {
+    lists.push_back(list);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 'compile' packs the children and lists of the states into arrays and
+// computes the failure links breadth first: the failure link of a state is
+// the longest proper suffix of its symbols that is a state too.  The tables
+// are then laid out as in an index file.
+////////////////////////////////////////////////////////////////////////////////
+void
+Gazetteer::compile(const vector<StringXML>& sources) {
+  const size_t states=_children.size();
+  vector<int32_t> edgeStart(1,0);
+  vector<int32_t> edgeSymbol;
+  vector<int32_t> edgeTarget;
+  vector<int32_t> listStart(1,0);
+  vector<int32_t> lists;
+  for (size_t s=0;s<states;s++) {
+    for (map<int,int>::const_iterator c=_children[s].begin();
+        c!=_children[s].end();c++) {
+      edgeSymbol.push_back(c->first);
+      edgeTarget.push_back(c->second);
+    }
+    edgeStart.push_back(edgeSymbol.size());
+    sort(_entryLists[s].begin(),_entryLists[s].end());
+    lists.insert(lists.end(),_entryLists[s].begin(),_entryLists[s].end());
+    listStart.push_back(lists.size());
+  }
+  vector<int32_t> fail(states,0);
+  vector<int32_t> output(states,-1);
+  deque<int> queue;
+  queue.push_back(0);
+  while (!queue.empty()) {
+    const int state=queue.front();
+    queue.pop_front();
+    for (int e=edgeStart[state];e<edgeStart[state+1];e++) {
+      const int id=edgeSymbol[e];
+      const int target=edgeTarget[e];
+      if (state!=0) {
+        // follow the failure links of the parent
+        int f=fail[state];
+        int c=childOf(&edgeStart[0],&edgeSymbol[0],&edgeTarget[0],f,id);
+        while (c<0 && f!=0) {
+          f=fail[f];
+          c=childOf(&edgeStart[0],&edgeSymbol[0],&edgeTarget[0],f,id);
+        }
+        fail[target]=(c>=0)?c:0;
+      }
+      const int f=fail[target];
+      output[target]=(listStart[f]<listStart[f+1])?f:output[f];
+      queue.push_back(target);
+    }
+  }
+  // the strings: names of the sources, then tokens and gaps, sorted
+  vector<pair<StringXML,int> > symbols[2];
+  symbols[0].assign(_tokens.begin(),_tokens.end());
+  symbols[1].assign(_gaps.begin(),_gaps.end());
+  StringXML strings;
+  vector<SourceStamp> stamps(sources.size());
+  for (size_t i=0;i<sources.size();i++) {
+    stampSource(sources[i],stamps[i]);
+    stamps[i].name=strings.size();
+    stamps[i].nameLength=sources[i].size();
+    strings+=sources[i];
+  }
+  vector<uint64_t> offsets[2];
+  vector<int32_t> ids[2];
+  for (int t=0;t<2;t++) {
+    sort(symbols[t].begin(),symbols[t].end());
+    for (size_t i=0;i<symbols[t].size();i++) {
+      offsets[t].push_back(strings.size());
+      ids[t].push_back(symbols[t][i].second);
+      strings+=symbols[t][i].first;
+    }
+    offsets[t].push_back(strings.size());
+  }
+  GazetteerHeader h;
+  memset(&h,0,sizeof(h));
+  memcpy(h.magic,indexMagic,sizeof(indexMagic));
+  h.version=indexVersion;
+  h.byteOrder=indexByteOrder;
+  h.sources=sources.size();
+  h.states=states;
+  h.edges=edgeSymbol.size();
+  h.lists=lists.size();
+  h.tokens=symbols[0].size();
+  h.gaps=symbols[1].size();
+  h.strings=strings.size();
+  uint64_t sizes[SECTIONS];
+  sectionSizes(h,sizes);
+  uint64_t end=sizeof(h);
+  for (int k=0;k<SECTIONS;k++) {
+    h.section[k]=align8(end);
+    end=h.section[k]+sizes[k];
+  }
+  h.size=end;
+  // lay the index out in memory
+  const void* from[SECTIONS]={
+    stamps.empty()?0:&stamps[0],&edgeStart[0],
+    edgeSymbol.empty()?0:&edgeSymbol[0],edgeTarget.empty()?0:&edgeTarget[0],
+    &listStart[0],lists.empty()?0:&lists[0],&fail[0],&output[0],
+    &_entryLength[0],&offsets[0][0],ids[0].empty()?0:&ids[0][0],
+    &offsets[1][0],ids[1].empty()?0:&ids[1][0],strings.data()
+  };
+  _image.assign(align8(h.size)/8,0);
+  char* data=reinterpret_cast<char*>(&_image[0]);
+  memcpy(data,&h,sizeof(h));
+  for (int k=0;k<SECTIONS;k++) {
+    if (sizes[k]>0) {
+      memcpy(data+h.section[k],from[k],sizes[k]);
+    }
+  }
+  // the tables used while adding entries are no longer needed
+  SymbolTable().swap(_tokens);
+  SymbolTable().swap(_gaps);
+  vector<map<int,int> >().swap(_children);
+  vector<vector<int> >().swap(_entryLists);
+  vector<int>().swap(_entryLength);
+  attach(data);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 'replaceFile' writes 'size' bytes to a temporary file next to 'file' and
+// renames it over 'file'.  Processes that have the old file mapped keep
+// reading it, and those that open 'file' find either the old or the new
+// contents, never part of them.  On failure the temporary file is removed.
+////////////////////////////////////////////////////////////////////////////////
+static bool
+replaceFile(const StringXML& file,const char* data,const uint64_t size) {
+  const StringXML pattern=file+".XXXXXX";
+  vector<char> temp(pattern.begin(),pattern.end());
+  temp.push_back('\0');
+  const int fd=mkstemp(&temp[0]);
+  if (fd<0) {
+    return false;
+  }
+  // mkstemp creates the file for its owner only
+  const mode_t mask=umask(0);
+  umask(mask);
+  bool written=(fchmod(fd,0666&~mask)==0);
+  for (uint64_t done=0;written&&(done<size);) {
+    const ssize_t n=write(fd,data+done,size-done);
+    if (n<0 && errno==EINTR) {
+      continue;
+    }
+    written=(n>0);
+    done+=written?n:0;
+  }
+  written=(close(fd)==0)&&written;
+  if (!written || rename(&temp[0],file.c_str())!=0) {
+    unlink(&temp[0]);
+    return false;
+  }
+  return true;
+}
+
+bool
+Gazetteer::save(const StringXML& file) const {
+  if (_states==0) {
+    return false;
+  }
+  const char* data=_mapped?static_cast<const char*>(_mapped):
+      reinterpret_cast<const char*>(&_image[0]);
+  const GazetteerHeader* h=reinterpret_cast<const GazetteerHeader*>(data);
+  return replaceFile(file,data,h->size);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 'load' maps the index read only, so that processes using the same index
+// share its pages
+////////////////////////////////////////////////////////////////////////////////
+bool
+Gazetteer::load(const StringXML& file,const vector<StringXML>& sources) {
+  int fd=open(file.c_str(),O_RDONLY);
+  if (fd<0) {
+    return false;
+  }
+  struct stat st;
+  if ((fstat(fd,&st)!=0)||
+      (static_cast<size_t>(st.st_size)<sizeof(GazetteerHeader))) {
+    close(fd);
+    return false;
+  }
+  void* m=mmap(0,st.st_size,PROT_READ,MAP_SHARED,fd,0);
+  close(fd);
+  if (m==MAP_FAILED) {
+    return false;
+  }
+  const char* data=static_cast<const char*>(m);
+  if (!validIndex(data,st.st_size) || !upToDate(data,sources)) {
+    munmap(m,st.st_size);
+    return false;
+  }
+  if (_mapped) {
+    munmap(_mapped,_mappedSize);
+  }
+  vector<uint64_t>().swap(_image);
+  _mapped=m;
+  _mappedSize=st.st_size;
+  attach(data);
+  return true;
+}
+
+void
+Gazetteer::attach(const char* data) {
+  const GazetteerHeader* h=reinterpret_cast<const GazetteerHeader*>(data);
+  _states=h->states;
+  _edgeStart=section<int32_t>(data,EDGE_START);
+  _edgeSymbol=section<int32_t>(data,EDGE_SYMBOL);
+  _edgeTarget=section<int32_t>(data,EDGE_TARGET);
+  _listStart=section<int32_t>(data,LIST_START);
+  _lists=section<int32_t>(data,LISTS);
+  _fail=section<int32_t>(data,FAIL);
+  _output=section<int32_t>(data,OUTPUT);
+  _length=section<int32_t>(data,LENGTH);
+  _tokenCount=h->tokens;
+  _tokenOffsets=section<uint64_t>(data,TOKEN_OFFSETS);
+  _tokenIds=section<int32_t>(data,TOKEN_IDS);
+  _gapCount=h->gaps;
+  _gapOffsets=section<uint64_t>(data,GAP_OFFSETS);
+  _gapIds=section<int32_t>(data,GAP_IDS);
+  _strings=section<char>(data,STRINGS);
+}
+
+int
+Gazetteer::symbol(const bool gap,const char* begin,const char* end) const {
+  const uint64_t* offsets=gap?_gapOffsets:_tokenOffsets;
+  const size_t length=end-begin;
+  // binary search for the string in the sorted strings
+  size_t low=0;
+  size_t high=gap?_gapCount:_tokenCount;
+  while (low<high) {
+    const size_t mid=(low+high)/2;
+    const size_t l=offsets[mid+1]-offsets[mid];
+    int c=memcmp(_strings+offsets[mid],begin,min(l,length));
+    if (c==0) {
+      c=(l<length)?-1:((l>length)?1:0);
+    }
+    if (c==0) {
+      return gap?_gapIds[mid]:_tokenIds[mid];
+    }
+    if (c<0) {
+      low=mid+1;
+    }
+    else {
+      high=mid;
+    }
+  }
+  return -1;
+}
+
+int
+Gazetteer::child(const int state,const int id) const {
+  return childOf(_edgeStart,_edgeSymbol,_edgeTarget,state,id);
+}
+
+int
+Gazetteer::next(int state,const int id) const {
+  if (id<0) {
+    return 0;
+  }
+  while (true) {
+    const int c=child(state,id);
+    if (c>=0) {
+      return c;
+    }
+    if (state==0) {
+      return 0;
+    }
+    state=_fail[state];
+  }
+}
+
+void
+Gazetteer::match(const vector<TokenDeco>& tokens,const StringXML& text,
+    vector<GazetteerMatch>& matches) const {
+  if (_states==0) {
+    return;
+  }
+  const char* t=text.data();
+  int state=0;
+  for (size_t k=0;k<tokens.size();k++) {
+    if (k>0) {
+      state=next(state,symbol(true,t+tokens[k-1].getEnd(),
+          t+tokens[k].getBegin()));
+    }
+    state=next(state,symbol(false,t+tokens[k].getBegin(),
+        t+tokens[k].getEnd()));
+    // every entry ending here: the state itself and those along its
+    // failure links
+    int found=(_listStart[state]<_listStart[state+1])?state:_output[state];
+    for (;found>=0;found=_output[found]) {
+      for (int l=_listStart[found];l<_listStart[found+1];l++) {
+        matches.push_back(GazetteerMatch(k+1-_length[found],k,_lists[l]));
+      }
+    }
+  }
+}
+
+vector<int>
+Gazetteer::find(const StringXML& entry) const {
+  vector<int> res;
+  vector<StringXML> parts;
+  if (_states==0 || !splitEntry(entry,parts)) {
+    return res;
+  }
+  int state=0;
+  for (unsigned int i=0;i<parts.size() && state>=0;i++) {
+    const char* p=parts[i].data();
+    const int id=symbol(i%2==1,p,p+parts[i].size());
+    state=(id>=0)?child(state,id):-1;
+  }
+  if (state>=0) {
+    res.assign(_lists+_listStart[state],_lists+_listStart[state+1]);
+  }
+  return res;
+}
+
+size_t
+Gazetteer::size() const {
+  return _states;
+}
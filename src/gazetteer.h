@@ -0,0 +1,190 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: gazetteer.h
+////////////////////////////////////////////////////////////////////////////////
+// This file contains the definition of the Gazetteer class.
+// A Gazetteer finds the entries of the entity lists in a tokenised text.  The
+// entries are split into tokens as the text is, and the tokens, and the text
+// between them, are stored in an Aho-Corasick automaton over token ids, so
+// that all the entries in a text are found in a single pass over its tokens.
+// A compiled Gazetteer can be saved to an index file and mapped back into
+// memory, as long as the list files it was built from do not change.
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2008  Diego Molla-Aliod <diego@ics.mq.edu.au>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __gazetteer__
+#define __gazetteer__
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <stdint.h>
+#include <ext/hash_map>
+#include "tokenDeco.h"
+#include "xml_string.h"
+
+using namespace std;
+
+namespace AF {
+
+////////////////////////////////////////////////////////////////////////////////
+// An entry of list 'list' found in the tokens 'first' to 'last'
+////////////////////////////////////////////////////////////////////////////////
+struct GazetteerMatch {
+  size_t first;
+  size_t last;
+  int list;
+  GazetteerMatch(const size_t f,const size_t l,const int i)
+      :first(f),last(l),list(i) {};
+};
+
+class Gazetteer {
+public:
+////////////////////////////////////////////////////////////////////////////////
+// Constructor: an empty gazetteer
+////////////////////////////////////////////////////////////////////////////////
+  Gazetteer();
+
+////////////////////////////////////////////////////////////////////////////////
+// Destructor, unmaps an index file
+////////////////////////////////////////////////////////////////////////////////
+  ~Gazetteer();
+
+////////////////////////////////////////////////////////////////////////////////
+// 'add' adds an entry of list number 'list'.  Entries that do not start and
+// end with a token (e.g. empty lines) can never be found and are skipped.
+// 'compile' must be called once all the entries are added.
+////////////////////////////////////////////////////////////////////////////////
+  void
+  add(const StringXML& entry,const int list);
+
+////////////////////////////////////////////////////////////////////////////////
+// 'compile' computes the failure links of the automaton and packs it.
+// 'sources' are the list files the entries were read from; their names,
+// times and contents are recorded, so that 'load' can tell when the index
+// is out of date.
+////////////////////////////////////////////////////////////////////////////////
+  void
+  compile(const vector<StringXML>& sources);
+
+////////////////////////////////////////////////////////////////////////////////
+// 'save' writes a compiled gazetteer to an index file, replacing it whole so
+// that processes mapping the old index are not disturbed.  Returns false if
+// the file cannot be written.
+////////////////////////////////////////////////////////////////////////////////
+  bool
+  save(const StringXML& file) const;
+
+////////////////////////////////////////////////////////////////////////////////
+// 'load' maps an index file into memory read only.  Returns false, leaving
+// the gazetteer unchanged, if the file is not a valid index or was built
+// from other list files, or from lists that have changed since.  A list
+// file counts as changed if its time or size differ and its contents do too.
+////////////////////////////////////////////////////////////////////////////////
+  bool
+  load(const StringXML& file,const vector<StringXML>& sources);
+
+////////////////////////////////////////////////////////////////////////////////
+// 'match' finds every entry in the tokens of 'text' given, i.e. every
+// sequence of tokens whose text, including the text between the tokens, is
+// an entry.  The matches are added to 'matches' in the order of their last
+// token.
+////////////////////////////////////////////////////////////////////////////////
+  void
+  match(const vector<TokenDeco>& tokens,const StringXML& text,
+      vector<GazetteerMatch>& matches) const;
+
+////////////////////////////////////////////////////////////////////////////////
+// 'find' returns the lists that have 'entry' as an entry
+////////////////////////////////////////////////////////////////////////////////
+  vector<int>
+  find(const StringXML& entry) const;
+
+////////////////////////////////////////////////////////////////////////////////
+// 'size' returns the number of states of the automaton
+////////////////////////////////////////////////////////////////////////////////
+  size_t
+  size() const;
+
+private:
+////////////////////////////////////////////////////////////////////////////////
+// A gazetteer may be mapped from a file, so it is not copied
+////////////////////////////////////////////////////////////////////////////////
+  Gazetteer(const Gazetteer& other);
+  Gazetteer& operator=(const Gazetteer& other);
+
+  typedef __gnu_cxx::hash_map<StringXML,int,hash_str> SymbolTable;
+
+////////////////////////////////////////////////////////////////////////////////
+// 'attach' points the tables of the automaton into a compiled gazetteer, in
+// the layout of an index file, that has been checked to be valid
+////////////////////////////////////////////////////////////////////////////////
+  void
+  attach(const char* data);
+
+////////////////////////////////////////////////////////////////////////////////
+// 'symbol' returns the id of the text from 'begin' to 'end', a token or the
+// text between two tokens, or -1 if no entry contains it
+////////////////////////////////////////////////////////////////////////////////
+  int
+  symbol(const bool gap,const char* begin,const char* end) const;
+
+////////////////////////////////////////////////////////////////////////////////
+// 'child' returns the state reached from 'state' by symbol 'id', or -1.
+// 'next' follows the failure links until a state with such a child is found.
+////////////////////////////////////////////////////////////////////////////////
+  int
+  child(const int state,const int id) const;
+
+  int
+  next(int state,const int id) const;
+
+  // while entries are added: the ids of the tokens and of the text between
+  // tokens, and the children, lists and length in tokens of each state
+  SymbolTable _tokens;
+  SymbolTable _gaps;
+  int _symbols;
+  vector<map<int,int> > _children;
+  vector<vector<int> > _entryLists;
+  vector<int> _entryLength;
+  // the compiled gazetteer, built in '_image' or mapped from an index file
+  vector<uint64_t> _image;
+  void* _mapped;
+  size_t _mappedSize;
+  // the tables of the compiled automaton (see gazetteer.cpp)
+  size_t _states;
+  const int32_t* _edgeStart;
+  const int32_t* _edgeSymbol;
+  const int32_t* _edgeTarget;
+  const int32_t* _listStart;
+  const int32_t* _lists;
+  const int32_t* _fail;
+  const int32_t* _output;
+  const int32_t* _length;
+  size_t _tokenCount;
+  const uint64_t* _tokenOffsets;
+  const int32_t* _tokenIds;
+  size_t _gapCount;
+  const uint64_t* _gapOffsets;
+  const int32_t* _gapIds;
+  const char* _strings;
+};
+
+}
+
+#endif
@@ -49,13 +49,13 @@ public:
 
   // iterator constructor.
   suffixtree_iterator(const suffixtree& st)
-      :tree(st),current(&st.root) {
+      :tree(&st),current(suffixtree::root) {
   }
 
   // first sets the iterator to the first element of the suffixtree
   void
   first() {
-    current=&tree.root;
+    current=suffixtree::root;
   }
 
   // next returns a vector of possible continuations from the current
@@ -64,7 +64,7 @@ public:
   // an exception.
   vector<element_type>
   next() const {
-    return current->next_children();
+    return tree->next_children(current);
   }
 
   // next sets the iterator to the next element of the suffixtree
@@ -73,8 +73,8 @@ public:
   // towards the element_type of the argument.
   void
   next(const element_type &e) {
-    const suffixtree::node *next_node=current->find_child(e);
-    if (next_node==0) {
+    suffixtree::node_id next_node=tree->find_child(current,e);
+    if (next_node==suffixtree::none) {
       throw OutOfBounds();
     }
     current=next_node;
@@ -84,7 +84,7 @@ public:
   // current node. If 0, then the node is a leaf (even though
   // sequential data may still be attached to it).
   size_type size() const {
-    return current->children_size();
+    return tree->children_size(current);
   }
 
   // is_done returns true if the current position is on a leaf, false
@@ -98,31 +98,124 @@ protected:
   // current_begin returns the begin iterator of the current node.
   const suffixtree::index
   current_begin() const {
-    return current->begin();
+    return tree->node_begin(current);
   }
 
   // current_end returns the end iterator of the current node.
   const suffixtree::index
   current_end() const {
-    return current->end();
+    return tree->node_end(current);
   }
 
   // current_number returns the number of the current node.
   const suffixtree::size_type
   current_number() const {
-    return current->give_number();
+    return tree->give_number(current);
   }
 
   // current_leaf_positions returns a vector of leaf positions that
   // can be reached from the current node.
   vector<size_type>
   current_leaf_positions() const {
-    return current->find_leaf_positions();
+    vector<size_type> result;
+    tree->find_leaf_positions(current,result);
+    return result;
+  }
+
+  // current_mask returns the mask of the current node (see
+  // suffixtree::set_masks).
+  const suffixtree::mask_type
+  current_mask() const {
+    return tree->give_mask(current);
+  }
+
+private:
+  const suffixtree *tree;
+  suffixtree::node_id current;
+};
+
+class suffixtree_cursor : public suffixtree_iterator {
+// suffixtree_cursor follows a string through the suffixtree one
+// element at a time, also within the substrings of the nodes, so
+// that a search can be extended without starting again from the
+// root.
+public:
+  typedef suffixtree::index index;
+
+  // cursor constructor. The cursor starts at the root, having read
+  // nothing.
+  suffixtree_cursor(const suffixtree& st)
+      :suffixtree_iterator(st),started(false),found(true) {
+  }
+
+  // advance moves the cursor past e. It returns false if the
+  // elements read so far are not a substring of the sentence; the
+  // cursor then stays invalid.
+  bool
+  advance(const element_type &e) {
+    if (!found) {
+      return false;
+    }
+    if (!started||seeker==current_end()) { // branch
+      try {
+        next(e);
+      }
+      catch (OutOfBounds) {
+        found=false;
+        return false;
+      }
+      seeker=current_begin();
+      started=true;
+    }
+    if (*seeker!=e) {
+      found=false;
+      return false;
+    }
+    seeker++;
+    return true;
+  }
+
+  // advance moves the cursor past the elements from b to e.
+  bool
+  advance(index b, const index e) {
+    while (b!=e) {
+      if (!advance(*b)) {
+        return false;
+      }
+      b++;
+    }
+    return found;
+  }
+
+  // valid returns true if the elements read so far are a (non
+  // empty) substring of the sentence.
+  bool
+  valid() const {
+    return started&&found;
+  }
+
+  // positions returns the positions of the elements read so far, as
+  // suffixtree::find_all_positions does.
+  vector<size_type>
+  positions() const {
+    if (!valid()) {
+      return vector<size_type>();
+    }
+    return current_leaf_positions();
+  }
+
+  // mask returns the groups of the positions of the elements read so
+  // far, as suffixtree::find_mask does.
+  suffixtree::mask_type
+  mask() const {
+    return valid()?current_mask():0;
   }
 
 private:
-  const suffixtree &tree;
-  const suffixtree::node *current;
+  // seeker points past the last element read in the current node
+  index seeker;
+  bool started;
+  bool found;
 };
 
 }
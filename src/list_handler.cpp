@@ -50,6 +50,8 @@ using namespace AF;
 
 ListHandler::ListHandler() {
   _num_lists=0;
+  _tree=0;
+  _masks=false;
 }
 
 ListHandler::ListHandler(const vector<StringXML>& filenames) {
@@ -65,29 +67,80 @@ ListHandler::ListHandler(const vector<StringXML>& filenames) {
     total += listString;
     i++;
   }
-  ofstream of;
-  of.open("data/total.list");
-  of << total << endl;
-  of.close();
-  _tree = new suffixtree(total);
+  BuildTree(total);
 }
 
-ListHandler::ListHandler(const map<StringXML,EntityTag> lists) {
+ListHandler::ListHandler(const map<StringXML,EntityTag> lists,
+    const bool trie,const StringXML& index) {
   int i=0;
   StringXML total;
   _num_lists = lists.size();
+  _tree = 0;
+  _masks = false;
+  vector<StringXML> listFiles;
   for (map<StringXML,EntityTag>::const_iterator list=lists.begin();
       list!=lists.end();list++) {
-    StringXML listString = ReadList(list->first);
-    ListBoundary l(ListBoundary(total.length(),
-                        total.length()+listString.length(),i));
-    _boundaries.push_back(l);
-    total += listString;
+    listFiles.push_back(list->first);
+  }
+  // an index that is up to date saves reading the lists
+  const bool indexed=trie && !index.empty() &&
+      _gazetteer.load(index,listFiles);
+  if (indexed) {
+    cout << "Using list index " << index << endl;
+  }
+  for (map<StringXML,EntityTag>::const_iterator list=lists.begin();
+      list!=lists.end();list++) {
+    if (trie && !indexed) {
+      vector<StringXML> entries;
+      ReadEntries(list->first,entries);
+      for (vector<StringXML>::const_iterator e=entries.begin();
+          e!=entries.end();e++) {
+        _gazetteer.add(*e,i);
+      }
+    }
+    else if (!trie) {
+      StringXML listString = ReadList(list->first);
+      ListBoundary l(ListBoundary(total.length(),
+                          total.length()+listString.length(),i));
+      _boundaries.push_back(l);
+      total += listString;
+    }
     // match the tag with the list
     _tags[i] = list->second;
     i++;
   }
+  if (trie && !indexed) {
+    _gazetteer.compile(listFiles);
+    if (!index.empty()) {
+      if (_gazetteer.save(index)) {
+        cout << "Saved list index " << index << endl;
+      }
+      else {
+        cerr << "Cannot write list index " << index << endl;
+      }
+    }
+  }
+  else if (!trie) {
+    BuildTree(total);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Builds the suffix tree of the lists, and records which lists are found
+// below each node of the tree if there are few enough lists
+////////////////////////////////////////////////////////////////////////////////
+void
+ListHandler::BuildTree(const StringXML& total) {
   _tree = new suffixtree(total);
+  _masks = (_num_lists <= 64);
+  if (_masks) {
+    vector<suffixtree::size_type> groups;
+    for (vector<ListBoundary>::const_iterator i=_boundaries.begin();
+        i!=_boundaries.end();i++) {
+      groups.push_back(i->begin);
+    }
+    _tree->set_masks(groups);
+  }
 }
 
 ListHandler::~ListHandler() {
@@ -101,7 +154,13 @@ ListHandler::~ListHandler() {
 vector<int>
 ListHandler::FindString(const StringXML& input, const bool complete,
       const bool extra) const {
-  vector<int> res;
+  if (_tree==0) {
+    vector<int> res;
+    if (complete) {
+      res=_gazetteer.find(input);
+    }
+    return res;
+  }
   StringXML search("^" + input);
   if (complete) {
     search=search + "|";
@@ -111,9 +170,53 @@ ListHandler::FindString(const StringXML& input, const bool complete,
       search=search + " ";
     }
   }
-  // find the occurrences, add start and end markers
-  vector<StringXML::size_type> locs =
-      _tree->find_all_positions(search);
+  ListCursor cursor(*_tree);
+  cursor.advance(search.begin(),search.end());
+  return CursorLists(cursor);
+}
+
+ListCursor
+ListHandler::StartSearch() const {
+  ListCursor cursor(*_tree);
+  cursor.advance('^');
+  return cursor;
+}
+
+bool
+ListHandler::ExtendSearch(ListCursor& cursor,
+    const StringXML::const_iterator begin,
+    const StringXML::const_iterator end) const {
+  if (!cursor.advance(begin,end)) {
+    return false;
+  }
+  if (_masks) {
+    return cursor.mask()!=0;
+  }
+  return !cursor.positions().empty();
+}
+
+vector<int>
+ListHandler::CompleteLists(const ListCursor& cursor) const {
+  ListCursor complete(cursor);
+  complete.advance('|');
+  return CursorLists(complete);
+}
+
+vector<int>
+ListHandler::CursorLists(const ListCursor& cursor) const {
+  vector<int> res;
+  // the lists below the node the search ends in are known
+  if (_masks) {
+    suffixtree::mask_type mask=cursor.mask();
+    for (int list=0;mask!=0;list++,mask>>=1) {
+      if (mask&1) {
+        res.push_back(list);
+      }
+    }
+    return res;
+  }
+  // find the occurrences
+  vector<StringXML::size_type> locs=cursor.positions();
   // for each found occurrence
   for (vector<StringXML::size_type>::const_iterator i=locs.begin();
       i!=locs.end();i++) {
@@ -131,6 +234,16 @@ ListHandler::FindString(const StringXML& input, const bool complete,
   return res;
 }
 
+bool
+ListHandler::UsesTrie() const {
+  return _tree==0;
+}
+
+const Gazetteer&
+ListHandler::GetGazetteer() const {
+  return _gazetteer;
+}
+
 const EntityTag*
 ListHandler::GetTag(const int list) const {
   map<int,EntityTag>::const_iterator f = _tags.find(list);
@@ -159,10 +272,21 @@ StringXML removeTags(const StringXML& input){
 
 StringXML
 ListHandler::ReadList(const StringXML& filename) {
-  ifstream inFile;
   StringXML out = "";
+  vector<StringXML> entries;
+  ReadEntries(filename,entries);
+  for (vector<StringXML>::const_iterator e=entries.begin();
+      e!=entries.end();e++) {
+    out += "^" + *e + "|";
+  }
+  return out;
+}
+
+void
+ListHandler::ReadEntries(const StringXML& filename,
+    vector<StringXML>& entries) {
+  ifstream inFile;
   inFile.open(filename.c_str());   // open file
-  StringXML in = "";
   if (!inFile) {    // if problem opening, report to cout
      cout << "Unable to open file: " << filename << endl;
   }
@@ -170,12 +294,10 @@ ListHandler::ReadList(const StringXML& filename) {
     while (! inFile.eof() ) {
       StringXML line="";
       getline(inFile,line);
-      line = "^" + removeTags(line) + "|";
-      out += line;
+      entries.push_back(removeTags(line));
     }
   }
   inFile.close();   // close file
-  return out;
 }
 
 int
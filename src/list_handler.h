@@ -42,6 +42,7 @@
 #include "iterator.h"
 #include "xml_string.h"
 #include "entity_tag.h"
+#include "gazetteer.h"
 
 using namespace std;
 using namespace boost;
@@ -49,6 +50,12 @@ using namespace ns_suffixtree;
 
 namespace AF {
 
+///////////////////////////////////////////////////////////////////////////////
+// A ListCursor is a search in the lists that can be extended (see
+// 'StartSearch')
+///////////////////////////////////////////////////////////////////////////////
+  typedef suffixtree_cursor ListCursor;
+
   class ListHandler {
     public:
       struct ListBoundary {
@@ -65,10 +72,15 @@ namespace AF {
 ///////////////////////////////////////////////////////////////////////////////
 // ListHandler constructor: accepts a vector of filenames, initialises
 // SuffixTree and list boundary indexes.
+// If 'trie' is true the entries are stored in a Gazetteer instead of the
+// SuffixTree; only complete entries can then be searched for.
+// If 'index' is given as well, the Gazetteer is mapped from that index file
+// when it is up to date with the lists, and built and saved to it otherwise.
 ///////////////////////////////////////////////////////////////////////////////
       ListHandler();
       ListHandler(const vector<StringXML>& filenames);
-      ListHandler(const map<StringXML,EntityTag> lists);
+      ListHandler(const map<StringXML,EntityTag> lists,const bool trie=false,
+          const StringXML& index="");
 ///////////////////////////////////////////////////////////////////////////////
 //  Destructor
 ///////////////////////////////////////////////////////////////////////////////
@@ -82,28 +94,72 @@ namespace AF {
 // default value is true.
 // 'extra' indicates whether the string should match with a space
 // following, default false.
+// If there are at most 64 lists, the lists are returned in order, and
+// without enumerating every occurrence of the string.
 ///////////////////////////////////////////////////////////////////////////////
       vector<int>
       FindString(const StringXML& input, const bool complete=true,
           const bool extra=false) const;
+
+///////////////////////////////////////////////////////////////////////////////
+// 'StartSearch' returns a cursor at the start of the entries of the lists.
+// 'ExtendSearch' moves the cursor past the text from 'begin' to 'end' and
+// returns whether an entry starts with the text read so far, i.e. whether
+// FindString(text,false) would find any list.  'CompleteLists' returns the
+// lists that have the text read so far as an entry, as FindString(text)
+// does.  Extending a search costs time linear in the text added.  These
+// are not available when the lists are in a Gazetteer.
+///////////////////////////////////////////////////////////////////////////////
+      ListCursor
+      StartSearch() const;
+
+      bool
+      ExtendSearch(ListCursor& cursor,const StringXML::const_iterator begin,
+          const StringXML::const_iterator end) const;
+
+      vector<int>
+      CompleteLists(const ListCursor& cursor) const;
       
       int
       ListCount() const;
 
       const EntityTag*
       GetTag(const int list) const;
+
+///////////////////////////////////////////////////////////////////////////////
+// 'UsesTrie' returns true if the entries are stored in the Gazetteer, which
+// 'GetGazetteer' returns
+///////////////////////////////////////////////////////////////////////////////
+      bool
+      UsesTrie() const;
+
+      const Gazetteer&
+      GetGazetteer() const;
       
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
     private:
       StringXML ReadList(const StringXML& filename);
 ///////////////////////////////////////////////////////////////////////////////
+// 'ReadEntries' reads the entries of a list file, without their tags
+///////////////////////////////////////////////////////////////////////////////
+      void ReadEntries(const StringXML& filename,vector<StringXML>& entries);
+      void BuildTree(const StringXML& total);
+///////////////////////////////////////////////////////////////////////////////
+// 'CursorLists' returns the lists that the positions of the text read by
+// the cursor fall in
+///////////////////////////////////////////////////////////////////////////////
+      vector<int> CursorLists(const ListCursor& cursor) const;
+///////////////////////////////////////////////////////////////////////////////
 // 'GetListint' returns the list that a given location in the tree
 // falls under.
 ///////////////////////////////////////////////////////////////////////////////
       int GetListInt(const StringXML::size_type location) const;
       int _num_lists;
       suffixtree* _tree;
+      // whether the tree knows the lists below each node
+      bool _masks;
+      Gazetteer _gazetteer;
       vector<ListBoundary> _boundaries;
       map<int,EntityTag> _tags;
   };
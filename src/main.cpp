@@ -30,16 +30,21 @@
 #include <sstream>
 #include <vector>
 #include <map>
+#include <set>
+#include <algorithm>
 #include <dirent.h>
 #include <boost/regex.hpp>
 #include <boost/program_options.hpp>
 #include <boost/filesystem/path.hpp>
 #include <boost/filesystem/operations.hpp>
+#include <boost/thread/mutex.hpp>
 #include "tokeniser.h"
 #include "ner.h"
 #include "entity_tag.h"
 #include "regex_handler.h"
 #include "list_handler.h"
+#include "maxent.h"
+#include "scheduler.h"
 
 using namespace std;
 using namespace AF;
@@ -51,16 +56,22 @@ void list_directory(const StringXML& path, vector<StringXML>& flisting,
     vector<StringXML>& dirlisting);
 void test(const vector<StringXML>& files,
     const vector<StringXML>& dirs,NEDeco deco,
-    const StringXML& format,const StringXML resultsDir, float threshold);
+    const StringXML& format,const StringXML resultsDir, float threshold,
+    const int threads=1);
 void testDirectory(const StringXML& path,NEDeco deco,const StringXML format,
     const StringXML resultsDir,float threshold);
 void testFile(const StringXML& path,const StringXML& fname,
-    NEDeco deco,const StringXML format,
-    const StringXML resultsDir, float threshold);
+    NEDeco& deco,const StringXML format,
+    const StringXML resultsDir, float threshold, ostream& log=cout);
+void testParallel(const vector<StringXML>& files,
+    const vector<StringXML>& dirs,const NEDeco& deco,
+    const StringXML& format,const StringXML resultsDir, float threshold,
+    const int threads);
    
 void train(const StringXML& outputFile, const vector<StringXML>& files,
     const vector<StringXML>& dirs,NEDeco deco,const int classCount,
-    const StringXML& freqFile,const StringXML& prevFreqFile);
+    const StringXML& freqFile,const StringXML& prevFreqFile,
+    const int threads=1);
 void trainDirectory(const StringXML& path,ostream& out,
     NEDeco deco,vector<map<StringXML,int> >& frequencies,
     vector<map<StringXML,int> >& prevFrequencies,
@@ -69,19 +80,19 @@ void trainFile(const StringXML& path,ostream& out,
     NEDeco deco, vector<map<StringXML,int> >& frequencies,
     vector<map<StringXML,int> >& prevFrequencies,
     const bool countFrequencies);
+void trainParallel(const vector<StringXML>& files,
+    const vector<StringXML>& dirs,ostream& out,const NEDeco& deco,
+    const int threads);
+void countParallel(const vector<StringXML>& files,
+    const vector<StringXML>& dirs,const NEDeco& deco,const int classCount,
+    const StringXML& freqFile,const StringXML& prevFreqFile,
+    const int threads);
 
 void setFeatureWeight(const StringXML& setting, FeatureHandler& fh);
 
 map<StringXML,EntityTag>
 InitializeListHandler(const StringXML& file);
 
-// A helper function to simplify the main part.
-template<class T>
-ostream& operator<<(ostream& os, const vector<T>& v) {
-  copy(v.begin(), v.end(), ostream_iterator<T>(cout, " "));
-  return os;
-}
-
 int main(int argc, char* argv[]) {
   vector<StringXML> files;
   vector<StringXML> dirs;
@@ -90,6 +101,7 @@ int main(int argc, char* argv[]) {
   StringXML listfiles = "";  
   StringXML trainDataFile="";
   StringXML modelFile="";
+  StringXML binaryModelFile="";
   StringXML regex_loc="";
   StringXML feature_regex_file="";
   StringXML outputLocation="";
@@ -98,7 +110,10 @@ int main(int argc, char* argv[]) {
   StringXML freqIn="";
   StringXML prevFreqIn="";
   int context=0;
+  int threads=1;
   StringXML format="NORMAL";
+  StringXML listMatcher="suffixtree";
+  StringXML listIndex="";
   int maxLabels=1;
   StringXML configFile="";
   bool dotest=false;
@@ -157,6 +172,15 @@ int main(int argc, char* argv[]) {
           value<StringXML>(&outputLocation)->default_value("afner-output"),
             "path to dump output from NER runs")
     ;
+    // options for converting models
+    options_description converting("Model conversion settings");
+    converting.add_options()
+      ("convert", "Set mode for converting the Yasmet model file given with"
+           " --model-file to the binary format")
+      ("binary-model-file",value<StringXML>(&binaryModelFile),
+           "binary model file to generate (default: the model file with"
+           " a .mdlb extension)")
+    ;
     // options for dumping NER input data
     options_description dumping("Data dumping settings");
     dumping.add_options()
@@ -175,6 +199,10 @@ int main(int argc, char* argv[]) {
            "range of contextual features used")
       ("entity_list",value<StringXML>(&listfiles)->default_value("config/list_spec"),
           "file containing location of entity lists paired with tags")
+      ("list-matcher",value<StringXML>(&listMatcher)->default_value("suffixtree"),
+          "how entries of the lists are found: suffixtree or trie")
+      ("list-index",value<StringXML>(&listIndex),
+          "index file of the lists, for the trie list matcher")
       ("tagset,g",value<StringXML>(&tagsetLoc)->default_value("config/BBN_tags"),
            "location of file storing tagset information")
       ("regex-file,x",value<StringXML>(&regex_loc)->default_value("config/regex"),
@@ -192,13 +220,15 @@ int main(int argc, char* argv[]) {
       ("prev-token-frequency-input", value<StringXML>(&prevFreqIn),
           "the location of previous token frequency information generated in"
           " training")
+      ("threads",value<int>(&threads)->default_value(1),
+          "number of threads used to process the files")
     ;
 
     options_description cmdline_options;
-    cmdline_options.add(command).add(config).add(running).add(training).add(dumping).add(counting);
+    cmdline_options.add(command).add(config).add(running).add(training).add(dumping).add(counting).add(converting);
 
     options_description config_file_options;
-    config_file_options.add(config).add(running).add(training).add(dumping).add(counting);
+    config_file_options.add(config).add(running).add(training).add(dumping).add(counting).add(converting);
     
     positional_options_description p;
     p.add("run-file",-1);
@@ -220,6 +250,32 @@ int main(int argc, char* argv[]) {
       return 1;
     }
     
+    // convert a Yasmet model to the binary format; nothing else is done
+    if (vm.count("convert")) {
+      ifstream modelIn(modelFile.c_str());
+      if (!modelIn) {
+        cout << "Unable to open model file " << modelFile << endl;
+        return 1;
+      }
+      modelIn.close();
+      if (binaryModelFile=="") {
+        binaryModelFile = modelFile;
+        if ((binaryModelFile.size()>4)&&
+            (binaryModelFile.substr(binaryModelFile.size()-4)==".mdl")) {
+          binaryModelFile.erase(binaryModelFile.size()-4);
+        }
+        binaryModelFile += ".mdlb";
+      }
+      MaxEnt model(0,modelFile);
+      if (!model.saveBinary(binaryModelFile)) {
+        cout << "Unable to write binary model file " << binaryModelFile
+             << endl;
+        return 1;
+      }
+      cout << "Binary model written to " << binaryModelFile << endl;
+      return EXIT_SUCCESS;
+    }
+
     // work out from passed parameters whether to test, train or count
     int countModes = 0;
     if (vm.count("count")) {
@@ -316,7 +372,16 @@ int main(int argc, char* argv[]) {
       cout << "Warning: no lists specified." << endl;
     }
     // if lists have been specified
-    ListHandler lh(InitializeListHandler(listfiles));
+    if (listMatcher!="suffixtree" && listMatcher!="trie") {
+      cerr << "Unknown list matcher " << listMatcher << endl;
+      return 1;
+    }
+    if (listIndex!="" && listMatcher!="trie") {
+      cout << "Warning: the list index is only used by the trie list matcher."
+           << endl;
+    }
+    ListHandler lh(InitializeListHandler(listfiles),listMatcher=="trie",
+        listIndex);
     // create the feature handler
     FeatureHandler fh(lh,rh,t,feature_regex_file,context,
 		      default_weight,freqIn,prevFreqIn);
@@ -330,17 +395,23 @@ int main(int argc, char* argv[]) {
     cout << endl;
     fh.printFeatures(cout);
     cout << endl;
+    // load the model once, it is shared by every document tagged
+    MaxEnt* model=0;
+    if (dotest) {
+      model = new MaxEnt(t.classCount(),modelFile);
+      model->compileFeatures(fh.getFeatureNames());
+    }
     // create the decorator object
-    NEDeco deco(&t,&rh,&lh,&fh,modelFile,maxLabels,context,singleLabels);
+    NEDeco deco(&t,&rh,&lh,&fh,model,maxLabels,context,singleLabels);
     if (docount) {
       cout << "COUNTING" << endl << endl;
       train(trainDataFile,files,dirs,deco,t.classCount(),freq,
-            prevFreq);
+            prevFreq,threads);
     }
     if (dotrain) {
       cout << "TRAINING" << endl << endl;
       train(trainDataFile,files,dirs,deco,t.classCount(),freq,
-            prevFreq);
+            prevFreq,threads);
       // if a model file is given, create the model file directly
       if (vm.count("model-file")) {
 	cout << "Generating model file. This may take some time..."
@@ -355,12 +426,13 @@ int main(int argc, char* argv[]) {
     if (dodump) {
       cout << "DUMPING" << endl << endl;
       train(trainDataFile,files,dirs,deco,t.classCount(),freq,
-            prevFreq);
+            prevFreq,threads);
     }
     if (dotest) {
       cout << "TESTING" << endl;
-      test(files,dirs,deco,format,outputLocation,threshold);
+      test(files,dirs,deco,format,outputLocation,threshold,threads);
     }
+    delete model;
   }
   catch(std::exception& e) {
     cerr << "error: " << e.what() << endl;
@@ -416,21 +488,30 @@ void trainDirectory(const StringXML& path,ostream& out,NEDeco deco,
   cout << endl << endl;
 }
 
-// given a model file, do the Entity checking
-void testFile(const StringXML& path,const StringXML& fname,
-    NEDeco deco,const StringXML format,
-    const StringXML resultsDir, float threshold) {
-  StringXML fullname = path + "/" + fname;
+// the name of the file 'fname' in 'path', and of the file its results are
+// written to
+void testFileNames(const StringXML& path,const StringXML& fname,
+    const StringXML& resultsDir,StringXML& fullname,StringXML& resultfile) {
+  fullname = path + "/" + fname;
   StringXML simpFilename=fname;
   if (path==".") {
     fullname = fname;
     int slashpos=fname.rfind("/",fname.size()-1);
     simpFilename=fname.substr(slashpos,fname.size());
   }
+  resultfile = resultsDir + "/" + simpFilename;
+}
+
+// given a model file, do the Entity checking
+void testFile(const StringXML& path,const StringXML& fname,
+    NEDeco& deco,const StringXML format,
+    const StringXML resultsDir, float threshold, ostream& log) {
+  StringXML fullname;
+  StringXML resultfile;
+  testFileNames(path,fname,resultsDir,fullname,resultfile);
   StringXML text = readfile(fullname);
-  StringXML resultfile = resultsDir + "/" + simpFilename;
-  cout << "\tRunning file: " << fullname << endl;
-  cout << "\tOutput file: " << resultfile << endl;
+  log << "\tRunning file: " << fullname << endl;
+  log << "\tOutput file: " << resultfile << endl;
   //NEDeco deco(text,t,rh,modelFile,maxLabels,context,singleLabels);
   deco.Decorate(&text);
   ofstream outfile;
@@ -456,12 +537,109 @@ void testFile(const StringXML& path,const StringXML& fname,
       outfile.close();
     }
     else {
-      cout << "Unable to open " << resultfile << endl;
+      log << "Unable to open " << resultfile << endl;
     }
   }
   //deco.printEnts();
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// A file to tag in parallel, and the directory to write its results to
+////////////////////////////////////////////////////////////////////////////////
+struct TestJob {
+  StringXML path;
+  StringXML fname;
+  StringXML resultsDir;
+  TestJob(const StringXML& p,const StringXML& f,const StringXML& r)
+      :path(p),fname(f),resultsDir(r) {};
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Tags files in parallel.  Each thread has its own decorator; the handlers
+// and model the decorators point to are shared and only read.
+////////////////////////////////////////////////////////////////////////////////
+class TestJobs : public ScheduledJobs {
+public:
+  TestJobs(const vector<TestJob>& jobs,const NEDeco& deco,
+      const unsigned int threads,const StringXML& format,float threshold)
+      :_jobs(jobs),_decos(threads,deco),_format(format),
+      _threshold(threshold) {};
+
+  void
+  run(const size_t job,const unsigned int worker) {
+    const TestJob& j=_jobs[job];
+    ostringstream log;
+    testFile(j.path,j.fname,_decos[worker],_format,j.resultsDir,_threshold,
+        log);
+    boost::mutex::scoped_lock lock(_logLock);
+    cout << log.str() << flush;
+  }
+
+private:
+  const vector<TestJob>& _jobs;
+  vector<NEDeco> _decos;
+  const StringXML _format;
+  const float _threshold;
+  boost::mutex _logLock;
+};
+
+// adds the files in 'path' and, recursively, its subdirectories to 'jobs',
+// in the order testDirectory visits them
+void testDirectoryJobs(const StringXML& path,const StringXML& resultsDir,
+    vector<TestJob>& jobs) {
+  vector<StringXML> flist;
+  vector<StringXML> dirlist;
+  list_directory(path,flist,dirlist);
+  for (unsigned int i=0;i<flist.size();i++) {
+    jobs.push_back(TestJob(path,flist[i],resultsDir));
+  }
+  for (unsigned int i=0;i<dirlist.size();i++) {
+    testDirectoryJobs(path + "/" + dirlist[i],resultsDir + "/" + dirlist[i],
+        jobs);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 'testParallel' tags the same files as 'test', spread over a pool of
+// threads.  Every file is written by one job only, so the results are the
+// same as those of a serial run.
+////////////////////////////////////////////////////////////////////////////////
+void testParallel(const vector<StringXML>& files,
+    const vector<StringXML>& dirs,const NEDeco& deco,
+    const StringXML& format,const StringXML resultsDir, float threshold,
+    const int threads) {
+  vector<TestJob> all;
+  for (vector<StringXML>::const_iterator ite=files.begin();
+      ite!=files.end();ite++) {
+    all.push_back(TestJob(".",*ite,resultsDir));
+  }
+  for (vector<StringXML>::const_iterator ite=dirs.begin();
+      ite!=dirs.end();ite++) {
+    testDirectoryJobs(*ite,resultsDir,all);
+  }
+  // if two files have the same results file only the last one is kept, as
+  // in a serial run it would overwrite the results of the first
+  vector<TestJob> jobs;
+  set<StringXML> written;
+  for (vector<TestJob>::reverse_iterator ite=all.rbegin();
+      ite!=all.rend();ite++) {
+    StringXML fullname;
+    StringXML resultfile;
+    testFileNames(ite->path,ite->fname,ite->resultsDir,fullname,resultfile);
+    if (written.insert(resultfile).second) {
+      jobs.push_back(*ite);
+    }
+  }
+  reverse(jobs.begin(),jobs.end());
+  Scheduler scheduler(threads);
+  cout << files.size() << " files, " << dirs.size() << " directories." << endl;
+  cout << "Running " << jobs.size() << " files on " << scheduler.threads()
+      << " threads" << endl << endl;
+  TestJobs testJobs(jobs,deco,scheduler.threads(),format,threshold);
+  scheduler.run(testJobs,jobs.size());
+  cout << jobs.size() << " files done" << endl;
+}
+
 void trainFile(const StringXML& path, ostream& out,NEDeco deco,
     vector<map<StringXML,int> >& frequencies,
     vector<map<StringXML,int> >& prevFrequencies,
@@ -471,9 +649,208 @@ void trainFile(const StringXML& path, ostream& out,NEDeco deco,
       countFrequencies);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Dumps the training data of files in parallel.  Each thread has its own
+// decorator and formats the events of a whole file into a block; the blocks
+// are written out in the order of the files, each one as soon as all the
+// blocks before it have been written.
+////////////////////////////////////////////////////////////////////////////////
+class TrainJobs : public ScheduledJobs {
+public:
+  TrainJobs(const vector<StringXML>& files,const NEDeco& deco,
+      const unsigned int threads,ostream& out)
+      :_files(files),_decos(threads,deco),_out(out),_next(0) {};
+
+  void
+  run(const size_t job,const unsigned int worker) {
+    StringXML text(readfile(_files[job]));
+    ostringstream block;
+    vector<map<StringXML,int> > frequencies;
+    vector<map<StringXML,int> > prevFrequencies;
+    _decos[worker].PrintTrainingData(&text,false,block,frequencies,
+        prevFrequencies,false);
+    boost::mutex::scoped_lock lock(_writeLock);
+    _blocks[job]=block.str();
+    // write out the blocks that are next in order
+    map<size_t,StringXML>::iterator next=_blocks.begin();
+    while (next!=_blocks.end() && next->first==_next) {
+      _out << next->second;
+      _blocks.erase(next++);
+      _next++;
+    }
+  }
+
+private:
+  const vector<StringXML>& _files;
+  vector<NEDeco> _decos;
+  ostream& _out;
+  // blocks finished but not yet written, and the number of the next block
+  map<size_t,StringXML> _blocks;
+  size_t _next;
+  boost::mutex _writeLock;
+};
+
+// puts the files 'train' reads in 'jobs', in the order it reads them.  As in
+// 'trainDirectory' only the files directly in each directory are used.
+void trainFileList(const vector<StringXML>& files,
+    const vector<StringXML>& dirs,vector<StringXML>& jobs) {
+  jobs=files;
+  for (vector<StringXML>::const_iterator ite=dirs.begin();
+      ite!=dirs.end();ite++) {
+    vector<StringXML> flist;
+    vector<StringXML> dirlist;
+    list_directory(*ite,flist,dirlist);
+    for (unsigned int i=0;i<flist.size();i++) {
+      jobs.push_back(*ite + "/" + flist[i]);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 'trainParallel' dumps the training data of the same files as 'train', in
+// the same order, using a pool of threads.
+////////////////////////////////////////////////////////////////////////////////
+void trainParallel(const vector<StringXML>& files,
+    const vector<StringXML>& dirs,ostream& out,const NEDeco& deco,
+    const int threads) {
+  vector<StringXML> jobs;
+  trainFileList(files,dirs,jobs);
+  Scheduler scheduler(threads);
+  cout << "Dumping " << jobs.size() << " files on " << scheduler.threads()
+      << " threads" << endl;
+  TrainJobs trainJobs(jobs,deco,scheduler.threads(),out);
+  scheduler.run(trainJobs,jobs.size(),true);
+  cout << jobs.size() << " files done" << endl << endl;
+}
+
+typedef vector<pair<StringXML,int> > Frequencies;
+
+////////////////////////////////////////////////////////////////////////////////
+// Counts the token frequencies of files in parallel.  Each thread has its own
+// decorator and counts into its own hash tables, one per tag.
+////////////////////////////////////////////////////////////////////////////////
+class CountJobs : public ScheduledJobs {
+public:
+  CountJobs(const vector<StringXML>& files,const NEDeco& deco,
+      const unsigned int threads,const int classCount)
+      :_files(files),_decos(threads,deco),
+      _frequencies(threads,vector<FrequencyTable>(classCount)),
+      _prevFrequencies(threads,vector<FrequencyTable>(classCount)) {};
+
+  void
+  run(const size_t job,const unsigned int worker) {
+    StringXML text(readfile(_files[job]));
+    _decos[worker].CountFrequencies(&text,_frequencies[worker],
+        _prevFrequencies[worker]);
+  }
+
+  // the counts of each thread, by tag
+  vector<vector<FrequencyTable> >&
+  frequencies(const bool previous) {
+    return previous?_prevFrequencies:_frequencies;
+  }
+
+private:
+  const vector<StringXML>& _files;
+  vector<NEDeco> _decos;
+  vector<vector<FrequencyTable> > _frequencies;
+  vector<vector<FrequencyTable> > _prevFrequencies;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Merges the counts of the threads in parallel, one job per tag for the
+// token frequencies and one per tag for the previous token frequencies, and
+// sorts the merged counts by token.
+////////////////////////////////////////////////////////////////////////////////
+class MergeJobs : public ScheduledJobs {
+public:
+  MergeJobs(CountJobs& counts,const int classCount)
+      :_counts(counts),_classCount(classCount),
+      _frequencies(classCount),_prevFrequencies(classCount) {};
+
+  void
+  run(const size_t job,const unsigned int worker) {
+    const bool previous=(job>=_classCount);
+    const size_t tag=job%_classCount;
+    vector<vector<FrequencyTable> >& counts=_counts.frequencies(previous);
+    // add the counts of the other threads to those of the first
+    FrequencyTable& merged=counts[0][tag];
+    for (size_t t=1;t<counts.size();t++) {
+      FrequencyTable& table=counts[t][tag];
+      for (FrequencyTable::const_iterator ite=table.begin();
+          ite!=table.end();ite++) {
+        merged[ite->first]+=ite->second;
+      }
+      FrequencyTable().swap(table);
+    }
+    Frequencies& sorted=previous?_prevFrequencies[tag]:_frequencies[tag];
+    sorted.assign(merged.begin(),merged.end());
+    FrequencyTable().swap(merged);
+    sort(sorted.begin(),sorted.end());
+  }
+
+  // the merged counts, sorted by token, by tag
+  const vector<Frequencies>&
+  frequencies(const bool previous) const {
+    return previous?_prevFrequencies:_frequencies;
+  }
+
+private:
+  CountJobs& _counts;
+  const size_t _classCount;
+  vector<Frequencies> _frequencies;
+  vector<Frequencies> _prevFrequencies;
+};
+
+// writes the token counts of each tag to 'file', in the format of 'train'
+void writeFrequencies(const StringXML& file,
+    const vector<Frequencies>& frequencies) {
+  ofstream out;
+  out.open(file.c_str());
+  // for each tag
+  for (unsigned int j=0;j<frequencies.size();j++) {
+    out << "#### Tag " << j << " --------------------" << endl;
+    // print each token
+    for (Frequencies::const_iterator ite=frequencies[j].begin();
+        ite!=frequencies[j].end();ite++) {
+      out << ite->first << " " << ite->second << endl;
+    }
+    out << endl;
+  }
+  out.close();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 'countParallel' counts the token frequencies of the same files as 'train'
+// using a pool of threads, and writes them to the same files, in the same
+// format.
+////////////////////////////////////////////////////////////////////////////////
+void countParallel(const vector<StringXML>& files,
+    const vector<StringXML>& dirs,const NEDeco& deco,const int classCount,
+    const StringXML& freqFile,const StringXML& prevFreqFile,
+    const int threads) {
+  vector<StringXML> jobs;
+  trainFileList(files,dirs,jobs);
+  Scheduler scheduler(threads);
+  cout << "Counting " << jobs.size() << " files on " << scheduler.threads()
+      << " threads" << endl;
+  CountJobs countJobs(jobs,deco,scheduler.threads(),classCount);
+  scheduler.run(countJobs,jobs.size());
+  MergeJobs mergeJobs(countJobs,classCount);
+  scheduler.run(mergeJobs,2*classCount);
+  cout << jobs.size() << " files done" << endl << endl;
+  writeFrequencies(freqFile,mergeJobs.frequencies(false));
+  writeFrequencies(prevFreqFile,mergeJobs.frequencies(true));
+}
+
 void test(const vector<StringXML>& files,
     const vector<StringXML>& dirs,NEDeco deco,
-    const StringXML& format,const StringXML resultsDir, float threshold) {
+    const StringXML& format,const StringXML resultsDir, float threshold,
+    const int threads) {
+  if (threads>1) {
+    testParallel(files,dirs,deco,format,resultsDir,threshold,threads);
+    return;
+  }
   cout << files.size() << " files, " << dirs.size() << " directories." << endl;
   cout << "Files: " << endl; 
   for (unsigned int i=0;i<files.size();i++) {
@@ -494,7 +871,8 @@ void test(const vector<StringXML>& files,
 
 void train(const StringXML& outputFile, const vector<StringXML>& files,
     const vector<StringXML>& dirs,NEDeco deco,const int classCount,
-    const StringXML& freqFile,const StringXML& prevFreqFile) {
+    const StringXML& freqFile,const StringXML& prevFreqFile,
+    const int threads) {
   ofstream out;
   out.open(outputFile.c_str());
   out << classCount << endl;
@@ -522,6 +900,17 @@ void train(const StringXML& outputFile, const vector<StringXML>& files,
     prevFrequencies.push_back(pm);
   }
   cout << files.size() << " files, " << dirs.size() << " directories." << endl;
+  if (threads>1) {
+    if (countFrequencies) {
+      countParallel(files,dirs,deco,classCount,freqFile,prevFreqFile,
+          threads);
+    }
+    else {
+      trainParallel(files,dirs,out,deco,threads);
+    }
+    out.close();
+    return;
+  }
   cout << "Files: " << endl;
   for (unsigned int i=0;i<files.size();i++) {
     cout << '_' << flush;
@@ -32,12 +32,170 @@
 #include <numeric>
 #include <ext/hash_map>
 #include <sstream>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cerrno>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "maxent.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 using namespace std; 
 
-typedef pair<int,double> fea;
-typedef vector<fea> vfea;
+////////////////////////////////////////////////////////////////////////////////
+// SCORING KERNELS
+// The SSE2 versions do the same multiplications and additions, in the same
+// order for each class, as the plain loops, so results do not depend on the
+// instruction set used.
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// 'addFeatureRow' adds value times a row of the weight matrix to the class
+// scores, and value to the class sums of the classes that have a weight.
+// n must be even.  Returns the largest class sum.
+////////////////////////////////////////////////////////////////////////////////
+static double
+addFeatureRow(double* scores,double* fs,const double* weights,
+    const double* present,const double value,const size_t n) {
+#ifdef __SSE2__
+  const __m128d v=_mm_set1_pd(value);
+  __m128d m=_mm_set1_pd(-HUGE_VAL);
+  for (size_t c=0; c<n; c+=2) {
+    __m128d s=_mm_loadu_pd(scores+c);
+    __m128d f=_mm_loadu_pd(fs+c);
+    s=_mm_add_pd(s,_mm_mul_pd(_mm_loadu_pd(weights+c),v));
+    f=_mm_add_pd(f,_mm_mul_pd(_mm_loadu_pd(present+c),v));
+    _mm_storeu_pd(scores+c,s);
+    _mm_storeu_pd(fs+c,f);
+    m=_mm_max_pd(m,f);
+  }
+  double r[2];
+  _mm_storeu_pd(r,m);
+  return max(r[0],r[1]);
+#else
+  double m=-HUGE_VAL;
+  for (size_t c=0; c<n; c++) {
+    scores[c]+=weights[c]*value;
+    fs[c]+=present[c]*value;
+    m=max(m,fs[c]);
+  }
+  return m;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 'expNormalise' turns the n scores given into probabilities: the largest
+// score is subtracted before exponentiating, and the results are divided by
+// their sum.  The sum is taken in order so that it is exactly reproducible.
+////////////////////////////////////////////////////////////////////////////////
+static void
+expNormalise(double* p,const size_t n) {
+  size_t c=0;
+  double max=-HUGE_VAL;
+#ifdef __SSE2__
+  __m128d m=_mm_set1_pd(-HUGE_VAL);
+  for (; c+1<n; c+=2) {
+    m=_mm_max_pd(m,_mm_loadu_pd(p+c));
+  }
+  double r[2];
+  _mm_storeu_pd(r,m);
+  max=std::max(r[0],r[1]);
+#endif
+  for (; c<n; c++) {
+    max=std::max(max,p[c]);
+  }
+  double sum=0.0;
+  for (c=0; c<n; c++) {
+    p[c]=exp(p[c]-max);
+    sum+=p[c];
+  }
+  c=0;
+#ifdef __SSE2__
+  const __m128d s=_mm_set1_pd(sum);
+  for (; c+1<n; c+=2) {
+    _mm_storeu_pd(p+c,_mm_div_pd(_mm_loadu_pd(p+c),s));
+  }
+#endif
+  for (; c<n; c++) {
+    p[c]/=sum;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BINARY MODEL FORMAT
+// A header followed by the log-weights of the features (the corrective
+// feature first, as in the Yasmet model), the feature ids sorted by name,
+// the offset of each name in the string table (plus one for its end) and the
+// NUL terminated names.  Every section starts at a multiple of 8 bytes.
+// Numbers are stored in the byte order of the machine that wrote the file.
+////////////////////////////////////////////////////////////////////////////////
+static const char binaryMagic[8]={'A','F','N','E','R','M','D','B'};
+static const uint32_t binaryVersion=1;
+static const uint32_t binaryByteOrder=0x01020304;
+
+struct BinaryModelHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint64_t count;    // number of features
+  uint64_t weights;  // offset of double[count]
+  uint64_t index;    // offset of uint32_t[count]
+  uint64_t names;    // offset of uint64_t[count+1]
+  uint64_t strings;  // offset of the names
+  uint64_t size;     // size of the file
+};
+
+// orders feature ids by name
+struct FeatureNameOrder {
+  const vector<pair<string,double> >& names;
+  FeatureNameOrder(const vector<pair<string,double> >& n):names(n) {};
+  bool operator()(const uint32_t a,const uint32_t b) const {
+    return names[a].first<names[b].first;
+  }
+};
+
+static uint64_t
+align8(const uint64_t offset) {
+  return (offset+7)&~static_cast<uint64_t>(7);
+}
+
+// 'replaceFile' writes 'size' bytes to a new file beside 'file' and renames
+// it over 'file', so that a model mapped by a running process is left alone;
+// the new file is removed if anything fails
+static bool
+replaceFile(const StringXML& file,const char* data,const uint64_t size) {
+  const StringXML pattern=file+".XXXXXX";
+  vector<char> temp(pattern.begin(),pattern.end());
+  temp.push_back('\0');
+  const int fd=mkstemp(&temp[0]);
+  if (fd<0) {
+    return false;
+  }
+  // mkstemp gives the file to its owner only: apply the umask instead
+  const mode_t mask=umask(0);
+  umask(mask);
+  bool written=(fchmod(fd,0666&~mask)==0);
+  for (uint64_t done=0;written&&(done<size);) {
+    const ssize_t n=write(fd,data+done,size-done);
+    if (n<0 && errno==EINTR) {
+      continue;
+    }
+    written=(n>0);
+    done+=written?n:0;
+  }
+  written=(close(fd)==0)&&written;
+  if (!written || rename(&temp[0],file.c_str())!=0) {
+    unlink(&temp[0]);
+    return false;
+  }
+  return true;
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 // PUBLIC FUNCTIONS
@@ -50,10 +208,37 @@ typedef vector<fea> vfea;
 ////////////////////////////////////////////////////////////////////////////////
 MaxEnt::MaxEnt(const unsigned int numberClasses,StringXML modelFile){
   C=numberClasses;
-  F=0.0;
+  compiledFeatures=0;
+  stride=C;
   lN=false; // length normalisation (arg)
-  dSmoothN=0.0;
-  read_model(modelFile);
+  mapped=0;
+  mappedSize=0;
+  mappedCount=0;
+  // binary models start with a magic string
+  char magic[sizeof(binaryMagic)];
+  ifstream in(modelFile.c_str(),ios::in|ios::binary);
+  if (in.read(magic,sizeof(magic))&&
+      (memcmp(magic,binaryMagic,sizeof(magic))==0)) {
+    in.close();
+    if (!map_model(modelFile)) {
+      cerr << "Invalid binary model file " << modelFile << endl;
+      // leave the model empty
+      read_model("");
+    }
+  }
+  else {
+    in.close();
+    read_model(modelFile);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// MaxEnt Destructor
+////////////////////////////////////////////////////////////////////////////////
+MaxEnt::~MaxEnt() {
+  if (mapped) {
+    munmap(mapped,mappedSize);
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -63,17 +248,112 @@ MaxEnt::MaxEnt(const unsigned int numberClasses,StringXML modelFile){
 ////////////////////////////////////////////////////////////////////////////////
 // function has been modified to check probabilities
 ////////////////////////////////////////////////////////////////////////////////
-//int
 vector<double>
-MaxEnt::classify(const FeatureVector& features) {
-  processFeatureVector(features);
-  vector<double> results = computeProbabilities();
-  // loop for debugging
-  for (vector<double>::const_iterator ite=results.begin();ite!=results.end();ite++){
+MaxEnt::classify(const FeatureVector& features,MaxEntBuffer& buffer) const {
+  vector<double> p(C);
+  processFeatureVector(features,buffer);
+  if (C>0) {
+    computeProbabilities(buffer,&p[0]);
   }
-  vector<double>::const_iterator max=max_element(results.begin(),results.end());
-  return results;
+  return p;
 }
+
+////////////////////////////////////////////////////////////////////////////////
+// MaxEnt batch classify
+// classifies every feature vector given, writing the probabilities of vector
+// i to probabilities[i*C] to probabilities[i*C+C-1]
+////////////////////////////////////////////////////////////////////////////////
+void
+MaxEnt::classify(const vector<FeatureVector>& features,
+    vector<double>& probabilities,MaxEntBuffer& buffer) const {
+  probabilities.resize(features.size()*C);
+  if (C==0) {
+    return;
+  }
+  for (size_t i=0;i<features.size();i++) {
+    processFeatureVector(features[i],buffer);
+    computeProbabilities(buffer,&probabilities[i*C]);
+  }
+}
+////////////////////////////////////////////////////////////////////////////////
+// 'compileFeatures' looks up the weight of every feature name given for every
+// class once, so that FeatureValues carrying the id of one of these names are
+// classified without formatting or hashing "cat<class>_<name>" strings.
+// The weights are stored as a [feature][class] matrix, each row padded to an
+// even number of classes for the scoring kernel.
+////////////////////////////////////////////////////////////////////////////////
+void
+MaxEnt::compileFeatures(const vector<StringXML>& features) {
+  compiledFeatures=features.size();
+  stride=C+C%2;
+  featureWeights.assign(compiledFeatures*stride,0.0);
+  featurePresent.assign(compiledFeatures*stride,0.0);
+  for (size_t id=0;id<compiledFeatures;id++) {
+    for (size_t i=0;i<C;i++) {
+      stringstream ss;
+      ss << "cat" << i << "_" << features[id];
+      const int index=featureIndex(ss.str());
+      if (index>=0) {
+        featureWeights[id*stride+i]=featureWeight(index);
+        featurePresent[id*stride+i]=1.0;
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 'saveBinary' writes the model in the binary format described above
+////////////////////////////////////////////////////////////////////////////////
+bool
+MaxEnt::saveBinary(const StringXML& file) const {
+  const size_t count=mapped?mappedCount:s2f.size();
+  vector<string> names(count);
+  vector<pair<string,double> > byName(count);
+  for (size_t i=0;i<count;i++) {
+    if (mapped) {
+      names[i]=mappedStrings+mappedNames[i];
+    }
+    else {
+      names[i]=s2f[i].first;
+    }
+    byName[i].first=names[i];
+  }
+  vector<uint32_t> index(count);
+  for (size_t i=0;i<count;i++) {
+    index[i]=i;
+  }
+  sort(index.begin(),index.end(),FeatureNameOrder(byName));
+  vector<uint64_t> offsets(count+1);
+  offsets[0]=0;
+  for (size_t i=0;i<count;i++) {
+    offsets[i+1]=offsets[i]+names[i].size()+1;
+  }
+  BinaryModelHeader h;
+  memset(&h,0,sizeof(h));
+  memcpy(h.magic,binaryMagic,sizeof(binaryMagic));
+  h.version=binaryVersion;
+  h.byteOrder=binaryByteOrder;
+  h.count=count;
+  h.weights=align8(sizeof(h));
+  h.index=align8(h.weights+count*sizeof(double));
+  h.names=align8(h.index+count*sizeof(uint32_t));
+  h.strings=align8(h.names+(count+1)*sizeof(uint64_t));
+  h.size=h.strings+offsets[count];
+  // lay the file out in memory and write it at once
+  vector<char> data(h.size,0);
+  memcpy(&data[0],&h,sizeof(h));
+  for (size_t i=0;i<count;i++) {
+    const double w=featureWeight(i);
+    memcpy(&data[h.weights+i*sizeof(double)],&w,sizeof(double));
+    memcpy(&data[h.strings+offsets[i]],names[i].c_str(),names[i].size()+1);
+  }
+  if (count>0) {
+    memcpy(&data[h.index],&index[0],count*sizeof(uint32_t));
+  }
+  memcpy(&data[h.names],&offsets[0],(count+1)*sizeof(uint64_t));
+  return replaceFile(file,&data[0],data.size());
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // 'printVector' prints a vector out for use as training data to the output
 // stream given
@@ -92,39 +372,43 @@ MaxEnt::printVector(const FeatureVector& features,ostream out){
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
-// 'processFeatureVector' reads a feature vector and modifies the classifier's
-// data members accordingly
+// 'processFeatureVector' reads a feature vector into the buffer given,
+// discarding whatever the buffer held for the previous token
 ////////////////////////////////////////////////////////////////////////////////
 void
-MaxEnt::processFeatureVector(const FeatureVector& features){  
-//  Class=2; // what does this do? Need to be there?
-  en.f.resize(C);
-  en.fs.resize(C);
-  en.Ny.resize(C);
-  size_t c=0; // class
-  en.Ny[c]=0.0;         // strength of class (first num after @)
+MaxEnt::processFeatureVector(const FeatureVector& features,
+    MaxEntBuffer& buffer) const {
+  vector<double>& scores=buffer.scores;
+  vector<double>& fs=buffer.fs;
+  double& F=buffer.F;
+  scores.assign(stride,0.0);
+  fs.assign(stride,0.0);
+  F=0.0;
   // for each feature
   for (FeatureVector::const_iterator feat = features.begin();
       feat!=features.end();feat++)
   {
-    // these loops may have to be reversed !!
-    // the classes may need to be looped over first, and features within
-    // instead of classes within feature loop
-    StringXML feature;
     double value = feat->getValue();
-    // for each class
+    if (value==0) {
+      continue;
+    }
+    // use the weight matrix built by compileFeatures if possible
+    const int id=feat->getId();
+    if ((id>=0)&&(static_cast<size_t>(id)<compiledFeatures)) {
+      F=max(F,addFeatureRow(&scores[0],&fs[0],&featureWeights[id*stride],
+          &featurePresent[id*stride],value,stride));
+      continue;
+    }
+    // otherwise look the feature up by name, for each class
     for (unsigned int i=0;i<C;i++){
       stringstream ss;
       ss << "cat" << i << "_" << feat->getFeature();
-      feature = ss.str();
-      if (value!=0) {
-      // set values
-      if (f2s.count(feature)!=0) { // check whether feature exists
-        (s2f)[f2s[feature]].second+=(en.Ny[i]!=0);
-        en.f[i].push_back(make_pair(f2s[feature], value));
-        en.fs[i]+=value;
-        F=max(F, en.fs[i]);
-      }
+      const int index=featureIndex(ss.str());
+      // set values if the feature exists
+      if (index>=0) {
+        scores[i]+=featureWeight(index)*value;
+        fs[i]+=value;
+        F=max(F, fs[i]);
       }
     }
   }
@@ -168,37 +452,121 @@ MaxEnt::read_model(const StringXML& model_file) {
   }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// 'map_model' maps a binary model into memory read only, so that processes
+// reading the same model share its pages, and checks its layout
+////////////////////////////////////////////////////////////////////////////////
+bool
+MaxEnt::map_model(const StringXML& model_file) {
+  int fd=open(model_file.c_str(),O_RDONLY);
+  if (fd<0) {
+    return false;
+  }
+  struct stat st;
+  if ((fstat(fd,&st)!=0)||
+      (static_cast<size_t>(st.st_size)<sizeof(BinaryModelHeader))) {
+    close(fd);
+    return false;
+  }
+  void* m=mmap(0,st.st_size,PROT_READ,MAP_SHARED,fd,0);
+  close(fd);
+  if (m==MAP_FAILED) {
+    return false;
+  }
+  const char* data=static_cast<const char*>(m);
+  const uint64_t size=st.st_size;
+  BinaryModelHeader h;
+  memcpy(&h,data,sizeof(h));
+  bool valid=(h.version==binaryVersion)&&(h.byteOrder==binaryByteOrder)&&
+      (h.size==size)&&(h.count>0)&&(h.count<=0xffffffffULL)&&
+      (h.weights%8==0)&&(h.index%8==0)&&(h.names%8==0)&&
+      (h.weights>=sizeof(h))&&(h.weights<=size)&&
+      (h.count*sizeof(double)<=size-h.weights)&&
+      (h.index>=h.weights+h.count*sizeof(double))&&(h.index<=size)&&
+      (h.count*sizeof(uint32_t)<=size-h.index)&&
+      (h.names>=h.index+h.count*sizeof(uint32_t))&&(h.names<=size)&&
+      ((h.count+1)*sizeof(uint64_t)<=size-h.names)&&
+      (h.strings>=h.names+(h.count+1)*sizeof(uint64_t))&&(h.strings<=size);
+  if (valid) {
+    const uint64_t* names=reinterpret_cast<const uint64_t*>(data+h.names);
+    const uint32_t* index=reinterpret_cast<const uint32_t*>(data+h.index);
+    // names must lie in the string table and be terminated; the offsets
+    // are compared with what is left of the file, so that they cannot wrap
+    for (uint64_t i=0;valid&&(i<h.count);i++) {
+      valid=(names[i]<names[i+1])&&(names[i+1]<=size-h.strings)&&
+          (data[h.strings+names[i+1]-1]==0)&&(index[i]<h.count);
+    }
+  }
+  if (!valid) {
+    munmap(m,st.st_size);
+    return false;
+  }
+  mapped=m;
+  mappedSize=st.st_size;
+  mappedCount=h.count;
+  mappedWeights=reinterpret_cast<const double*>(data+h.weights);
+  mappedIndex=reinterpret_cast<const uint32_t*>(data+h.index);
+  mappedNames=reinterpret_cast<const uint64_t*>(data+h.names);
+  mappedStrings=data+h.strings;
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 'featureIndex' returns the index of the feature named, or -1.  Binary
+// models are searched through their sorted index.
+////////////////////////////////////////////////////////////////////////////////
+int
+MaxEnt::featureIndex(const string& feature) const {
+  if (!mapped) {
+    hash_map<string,int,hash_str>::const_iterator f=f2s.find(feature);
+    return (f!=f2s.end())?f->second:-1;
+  }
+  size_t low=0;
+  size_t high=mappedCount;
+  while (low<high) {
+    const size_t mid=(low+high)/2;
+    const uint32_t id=mappedIndex[mid];
+    const int cmp=strcmp(mappedStrings+mappedNames[id],feature.c_str());
+    if (cmp==0) {
+      return id;
+    }
+    if (cmp<0) {
+      low=mid+1;
+    }
+    else {
+      high=mid;
+    }
+  }
+  return -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 'featureWeight' returns the log-weight of the feature with the index given
+////////////////////////////////////////////////////////////////////////////////
+double
+MaxEnt::featureWeight(const size_t index) const {
+  return mapped?mappedWeights[index]:z[index].l;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // MaxEnt computeProbabilities - private
 // Private function to classify a token after the data has been read in
+// The buffer holds the weighted sums of the token's active features, so only
+// the corrective feature is left to add before normalising.  The C
+// probabilities are written to p.
 ////////////////////////////////////////////////////////////////////////////////
-vector<double>
-MaxEnt::computeProbabilities() {
+void
+MaxEnt::computeProbabilities(MaxEntBuffer& buffer,double* p) const {
+  const vector<double>& scores=buffer.scores;
+  const vector<double>& fs=buffer.fs;
+  const double F=buffer.F;
   for (size_t c=0; c<C; ++c) {
     if (lN) {
-      for (size_t k=0; k<en.f[c].size(); ++k) {
-        en.f[c][k].second/=en.fs[c];
-      }
+      p[c]=scores[c]/fs[c];
     }
     else {
-      en.f[c].push_back(make_pair(0,F-en.fs[c]));
+      p[c]=scores[c]+featureWeight(0)*(F-fs[c]);
     }
   }
-  if (lN) {
-    F=1.0;
-  }
-  const event& ei=en;
-  size_t I=s2f.size();
-  z.resize(I);
-  for (size_t y=0; y<ei.Ny.size(); ++y) {
-    for (size_t j=0; j<ei.f[y].size(); ++j) {
-      z[ei.f[y][j].first].k+=1.0*ei.Ny[y]*ei.f[y][j].second;
-    }
-  }
-  for (size_t i=0; i<I; ++i) {
-    z[i].q=0;
-  }
-  vector<double> p(C);
-  ei.computeProb(z,p);
-  return p;
+  expNormalise(p,C);
 }
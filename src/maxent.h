@@ -33,6 +33,7 @@
 #include <utility>
 #include <iostream>
 #include <numeric>
+#include <stdint.h>
 #include <ext/hash_map>
 #include "feature_extraction.h"
 #include "xml_string.h"
@@ -42,9 +43,6 @@ using __gnu_cxx::hash;
 using namespace std; 
 using namespace AF;
 
-typedef pair<int,double> fea;
-typedef vector<fea> vfea;
-
 template<class T> ostream &
 operator<<(ostream&out,const vector<T>&x) {
   copy(x.begin(),x.end(),ostream_iterator<T>(out," "));
@@ -56,41 +54,17 @@ struct Z {
   Z(double a=0,double b=-1,double c=0):k(a),q(c),l((b<0)?1:log(b)) {};
 };
 
-struct expclass {
-  double
-  operator()(double x) {
-    return exp(x);
-  }
-};
-
-struct hash_str {
-  size_t
-  operator()(const string&s)const {
-    return __gnu_cxx::hash<const char*>()(s.c_str());
-  }
-};
-
-struct event {
-  vector<double> Ny;
-  size_t y;
-  vector<vfea> f;
-  vector<double> fs;
-
-  vector<double>&
-  computeProb(const vector<Z>&z,vector<double>&pr) const {
-    vector<double>::iterator p=pr.begin(),pb=pr.begin(),pe=pr.end();
-    for (vector<vfea>::const_iterator fi=f.begin(); fi!=f.end();
-        ++fi, ++p) {
-      *p=0.0;
-      for (vfea::const_iterator j=fi->begin(); j!=fi->end(); ++j) {
-        *p+=z[j->first].l*j->second;
-      }
-    }
-    transform(pb,pe,pb,bind2nd(plus<double>(),-*max_element(pb,pe)));
-    transform(pb,pe,pb,expclass());
-    transform(pb,pe,pb,bind2nd(divides<double>(),accumulate(pb,pe,0.0)));
-    return pr;
-  }
+////////////////////////////////////////////////////////////////////////////////
+// MaxEntBuffer
+// Scratch state used while classifying one token.  It is owned by the caller
+// so that a loaded model is never modified and can be shared; a buffer may be
+// reused for any number of tokens.
+////////////////////////////////////////////////////////////////////////////////
+struct MaxEntBuffer {
+  vector<double> scores; // weighted sum of the active features, per class
+  vector<double> fs;     // sum of the active feature values, per class
+  double F;              // largest value of fs, for the corrective feature
+  MaxEntBuffer():F(0.0) {};
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -106,17 +80,48 @@ public:
 ////////////////////////////////////////////////////////////////////////////////
 // Constructor
 // initialises variables, reads model
+// The model file is either a Yasmet model or a binary model written by
+// 'saveBinary'; binary models are mapped into memory read only.
 ////////////////////////////////////////////////////////////////////////////////
   MaxEnt(const unsigned int numberClasses,StringXML modelFile);
 ////////////////////////////////////////////////////////////////////////////////
+// Destructor, unmaps a binary model
+////////////////////////////////////////////////////////////////////////////////
+  ~MaxEnt();
+////////////////////////////////////////////////////////////////////////////////
 // classify accepts a FeatureVector and returns the category with the highest
 // probability, i.e. the classification
 ////////////////////////////////////////////////////////////////////////////////
 // function has been modified to check probabilites
+// The scratch state is kept in the buffer given, the model is left untouched
 ////////////////////////////////////////////////////////////////////////////////
-  //int
   vector <double>
-  classify(const FeatureVector& features);     //should this be const?
+  classify(const FeatureVector& features,MaxEntBuffer& buffer) const;
+////////////////////////////////////////////////////////////////////////////////
+// Batch classify: classifies each of the feature vectors given (e.g. all the
+// tokens of one or more documents) and stores the probabilities in a
+// [vector][class] matrix, row by row.  Apart from resizing 'probabilities'
+// and warming up the buffer, no memory is allocated.
+////////////////////////////////////////////////////////////////////////////////
+  void
+  classify(const vector<FeatureVector>& features,
+      vector<double>& probabilities,MaxEntBuffer& buffer) const;
+////////////////////////////////////////////////////////////////////////////////
+// 'compileFeatures' copies the weights of the features named into a dense
+// [feature][class] matrix indexed by the ids set in the FeatureValues (see
+// FeatureVectorValueExtractor), so that classify does not need to look up
+// features by name and can score all classes of a feature at once.
+////////////////////////////////////////////////////////////////////////////////
+  void
+  compileFeatures(const vector<StringXML>& features);
+////////////////////////////////////////////////////////////////////////////////
+// 'saveBinary' writes the model to the file given in the binary (.mdlb)
+// format: a table of feature names, an index of the names sorted, and the
+// weights.  The file is replaced whole, never rewritten in place, as other
+// processes may have it mapped.  Returns false if it cannot be written.
+////////////////////////////////////////////////////////////////////////////////
+  bool
+  saveBinary(const StringXML& file) const;
 ////////////////////////////////////////////////////////////////////////////////
 // 'printVector' prints a vector out for use as training data to the output
 // stream given
@@ -127,33 +132,64 @@ public:
 ////////////////////////////////////////////////////////////////////////////////
 private:
 ////////////////////////////////////////////////////////////////////////////////
+// A model may be mapped from a file, so it is not copied
+////////////////////////////////////////////////////////////////////////////////
+  MaxEnt(const MaxEnt& other);
+  MaxEnt& operator=(const MaxEnt& other);
+////////////////////////////////////////////////////////////////////////////////
 // 'read_model' reads a model from a given model file and inserts the values
 // into the classifier's data members
 ////////////////////////////////////////////////////////////////////////////////
   void
   read_model(const StringXML& model_file);
 ////////////////////////////////////////////////////////////////////////////////
-// 'processFeatureVector' reads a feature vector and modifies the classifier's
-// data members accordingly
+// 'map_model' maps a binary model file into memory.  Returns false if the
+// file is not a valid binary model.
+////////////////////////////////////////////////////////////////////////////////
+  bool
+  map_model(const StringXML& model_file);
+////////////////////////////////////////////////////////////////////////////////
+// 'featureIndex' returns the index of the feature named, or -1 if the model
+// has no such feature.  'featureWeight' returns the log-weight of a feature.
+////////////////////////////////////////////////////////////////////////////////
+  int
+  featureIndex(const string& feature) const;
+  double
+  featureWeight(const size_t index) const;
+////////////////////////////////////////////////////////////////////////////////
+// 'processFeatureVector' reads a feature vector into the buffer given
 ////////////////////////////////////////////////////////////////////////////////
   void
-  processFeatureVector(const FeatureVector& features);
+  processFeatureVector(const FeatureVector& features,
+      MaxEntBuffer& buffer) const;
 ////////////////////////////////////////////////////////////////////////////////
 // 'computeProbabilities' does the classification work.
 ////////////////////////////////////////////////////////////////////////////////
-  vector<double>
-  computeProbabilities();
+  void
+  computeProbabilities(MaxEntBuffer& buffer,double* p) const;
 ////////////////////////////////////////////////////////////////////////////////
 // Private Data Members - unsure of what they do exactly
 ////////////////////////////////////////////////////////////////////////////////
   vector<Z> z;
   vector<pair<string,double> > s2f;
   hash_map<string,int,hash_str> f2s;
+  // binary model: the mapping, and the weights, sorted index, name offsets
+  // and names in it
+  void* mapped;
+  size_t mappedSize;
+  size_t mappedCount;
+  const double* mappedWeights;
+  const uint32_t* mappedIndex;
+  const uint64_t* mappedNames;
+  const char* mappedStrings;
+  // compiled features: log-weight of each feature id and class (0 if the
+  // model has none) and whether the weight exists, 'stride' values per row
+  vector<double> featureWeights;
+  vector<double> featurePresent;
+  size_t compiledFeatures;
+  size_t stride;
   size_t C;
-  event en;
-  double F;
   bool lN; // length normalisation (arg)
-  double dSmoothN;
 };
 
 #endif
@@ -32,6 +32,7 @@
 #include <vector>
 #include <set>
 #include <cmath>
+#include <climits>
 #include <algorithm>
 #include <dirent.h>
 #include <boost/regex.hpp>
@@ -53,7 +54,22 @@ using namespace ns_suffixtree;
 using namespace AF;
 
 void markTokens(vector<vector<TokenDeco>::iterator>& toks,
-    const StringXML& info,const StringXML& text);
+    const int info,const StringXML& text);
+
+////////////////////////////////////////////////////////////////////////////////
+// The slot of the class of a token, and 'infoSlot', which returns the slot of
+// the information 'prefix' followed by 'number' from the slots looked up
+// before, if it is one of them
+////////////////////////////////////////////////////////////////////////////////
+static const int maxProbInfo=InfoRegistry::slot("maxProb");
+
+static int
+infoSlot(const vector<int>& slots,const StringXML& prefix,const int number) {
+  if (number>=0 && number<static_cast<int>(slots.size())) {
+    return slots[number];
+  }
+  return InfoRegistry::slot(prefix,number);
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 // 'extractType' Extracts the type as a string from an XML tag.
@@ -72,12 +88,16 @@ StringXML extractType(StringXML& token) {
 
 ////////////////////////////////////////////////////////////////////////////////
 //'tokeniseWithNEInfo' returns a vector of tokens that can be found between
-// begin and end, taking into account XML tags, but skipping them
+// begin and end, taking into account XML tags, but skipping them.  Their
+// information is stored in 'document'.
 ////////////////////////////////////////////////////////////////////////////////
 vector<TokenDeco>
 AF::tokeniseWithNEInfo(const StringXML::const_iterator begin,
-    const StringXML::const_iterator end,const EntityTagset* tset) {
-  vector<TokenDeco> tokens;
+    const StringXML::const_iterator end,const EntityTagset* tset,
+    TokenDocument& document) {
+  // the tokens that are not tags, and their classes
+  vector<Token> found;
+  vector<int> classes;
   // Create a token to add to the vector
   StringXML::const_iterator i = begin;
   Token token;
@@ -85,6 +105,11 @@ AF::tokeniseWithNEInfo(const StringXML::const_iterator begin,
   int currentClass = tset->outClass();
   // To store whether currently at the first token in a tag
   bool beginTag = true;
+  // the slots of the probabilities of the classes
+  vector<int> probInfo;
+  for (int i=0;i<tset->classCount();i++) {
+    probInfo.push_back(InfoRegistry::slot("prob",i));
+  }
   // While there are still tokens to get, get the token, not skipping tags
   StringXML tagText = "";
   EntityTag t;
@@ -111,22 +136,8 @@ AF::tokeniseWithNEInfo(const StringXML::const_iterator begin,
       tagText = "";
     }
     else {      // token is not a tag
-      TokenDeco neToken(&token);
-      // set the probabilities - max class
-      neToken.setInfo("maxProb",currentClass);
-      // for each class, set the probability to either 1 or 0
-      for (int i=0;i<tset->classCount();i++) {
-        stringstream ss;
-        ss << "prob" << i;
-        // if not at current class, set to 0, else 1
-        if (i!=currentClass) {
-          neToken.setInfo(ss.str(),0);
-        }
-        else {
-          neToken.setInfo(ss.str(),1);
-        }
-      }   
-      tokens.push_back(neToken);
+      found.push_back(token);
+      classes.push_back(currentClass);
       beginTag = false;
       // set class of next token, if still in a tag
       if (currentClass != tset->outClass()) {
@@ -135,6 +146,23 @@ AF::tokeniseWithNEInfo(const StringXML::const_iterator begin,
     }
     i=begin+token.getEnd();
   }
+  vector<TokenDeco> tokens = convertTokens(found,document);
+  for (vector<TokenDeco>::iterator neToken=tokens.begin();
+      neToken!=tokens.end();neToken++) {
+    const int tokenClass = classes[neToken-tokens.begin()];
+    // set the probabilities - max class
+    neToken->setInfo(maxProbInfo,tokenClass);
+    // for each class, set the probability to either 1 or 0
+    for (int i=0;i<tset->classCount();i++) {
+      // if not at current class, set to 0, else 1
+      if (i!=tokenClass) {
+        neToken->setInfo(probInfo[i],0);
+      }
+      else {
+        neToken->setInfo(probInfo[i],1);
+      }
+    }
+  }
   return tokens;
 }
 
@@ -249,11 +277,43 @@ NamedEntity::operator==(const NamedEntity& other) const {
 ////////////////////////////////////////////////////////////////////////////////
 NEDeco::NEDeco(const EntityTagset* t,const RegexHandler* rh,
     const ListHandler* lh,const FeatureHandler* fh,
-    const StringXML& modelFile,
+    const MaxEnt* model,
     const int maxLabels,const int context,const bool singleLabels)
     :_tagset(t),_regex_handler(rh),_list_handler(lh),
-    _feature_handler(fh),_modelFile(modelFile),_maxLabels(maxLabels),
+    _feature_handler(fh),_model(model),_maxLabels(maxLabels),
     _context(context),_singleLabels(singleLabels) {
+  if (_tagset!=0) {
+    for (int i=0;i<_tagset->classCount();i++) {
+      _probInfo.push_back(InfoRegistry::slot("prob",i));
+    }
+  }
+  if (_list_handler!=0) {
+    for (int i=0;i<_list_handler->ListCount();i++) {
+      _listInfo.push_back(InfoRegistry::slot("list",i));
+    }
+  }
+  if (_regex_handler!=0) {
+    for (int i=0;i<_regex_handler->RegexCount();i++) {
+      _regexInfo.push_back(InfoRegistry::slot("regex",i));
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Copy constructor: the tokens copied are moved to the copy of the document
+////////////////////////////////////////////////////////////////////////////////
+NEDeco::NEDeco(const NEDeco& other)
+    :_text(other._text),_tokens(other._tokens),_document(other._document),
+    _tagset(other._tagset),_regex_handler(other._regex_handler),
+    _list_handler(other._list_handler),
+    _feature_handler(other._feature_handler),_model(other._model),
+    _maxLabels(other._maxLabels),_context(other._context),
+    _singleLabels(other._singleLabels),_probInfo(other._probInfo),
+    _listInfo(other._listInfo),_regexInfo(other._regexInfo),
+    _entities(other._entities) {
+  for (vector<TokenDeco>::iterator i=_tokens.begin();i!=_tokens.end();i++) {
+    i->setDocument(&_document);
+  }
 }
 
 set<NamedEntity>::const_iterator
@@ -322,9 +382,10 @@ void NEDeco::printTRECEnts(const set<NamedEntity>& entities, ostream& out,
 void NEDeco::Decorate(StringXML* text) {
   // tokenise
   _text = text;
+  _entities.clear();
   vector<Token> tokens = tokenise(_text->begin(),_text->end());
   // convert tokens to TokenDecos, set variable
-  _tokens = convertTokens(tokens);
+  _tokens = convertTokens(tokens,_document);
   // match lists & regular expressions
   // create entities and decorate tokens with matches
   FindMatches(true);
@@ -337,6 +398,39 @@ void NEDeco::Decorate(StringXML* text) {
   }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// 'countTokens' adds the tokens given to the frequencies of their tags, and
+// the tokens before them to the previous token frequencies.  'Table' is a
+// map or a hash_map from the tokens to their counts.
+////////////////////////////////////////////////////////////////////////////////
+template<class Table>
+static void
+countTokens(const vector<TokenDeco>& tokens,const StringXML& text,
+    const EntityTagset* tagset,vector<Table>& frequencies,
+    vector<Table>& prevFrequencies) {
+  for (vector<TokenDeco>::const_iterator token = tokens.begin();
+       token != tokens.end(); token++) {
+    double d = 0;
+    token->getInfo(maxProbInfo,d);
+    int c = static_cast<int>(d);
+    if (c>0) {
+      int index = tagset->getIndex(c);
+      StringXML s(token->getBeginIterator(text.begin()),
+          token->getEndIterator(text.begin()));
+      // if token found, increment, otherwise set to 1
+      frequencies[index][s] += 1;
+      // update previousToken frequencies
+      if (token!=tokens.begin()) {
+        vector<TokenDeco>::const_iterator pToken = token;
+        pToken--;
+        StringXML ps(pToken->getBeginIterator(text.begin()),
+            pToken->getEndIterator(text.begin()));
+        prevFrequencies[index][ps] += 1;
+      }
+    }
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // 'printTrainingData' prints training data for the given string to the given
 // output stream. 'printClasses' is an optional argument to specify whether the
@@ -350,45 +444,12 @@ void NEDeco::PrintTrainingData(StringXML* text,const bool printClasses,
   _text = text;
   // tokenise the text
   _tokens = tokeniseWithNEInfo(_text->begin(),
-      _text->end(),_tagset);
+      _text->end(),_tagset,_document);
   ////////////////////////////////////////////////////////////
   // Count frequencies
   ////////////////////////////////////////////////////////////
   if (countFrequencies) {
-    for (vector<TokenDeco>::const_iterator token = _tokens.begin();
-	 token != _tokens.end(); token++) {
-      double d = 0;
-      token->getInfo("maxProb",d);
-      int c = static_cast<int>(d);      
-      if (c>0) {
-	int index = _tagset->getIndex(c);
-	StringXML s(token->getBeginIterator(_text->begin()),
-		    token->getEndIterator(_text->begin()));
-	map<StringXML,int>::iterator iter = frequencies[index].find(s);
-	// if token found, increment, otherwise set to 1
-	if (iter!=frequencies[index].end()) {
-	  iter->second += 1;
-	}
-	else {
-	  frequencies[index][s] = 1;
-	}
-	// update previousToken frequencies
-	if ((token)!=_tokens.begin()) {
-	  vector<TokenDeco>::const_iterator pToken = token;
-	  pToken--;
-	  StringXML ps(pToken->getBeginIterator(_text->begin()),
-		       pToken->getEndIterator(_text->begin()));
-	  map<StringXML,int>::iterator pIter = 
-	    prevFrequencies[index].find(ps);
-	  if (pIter!=prevFrequencies[index].end()) {
-	    pIter->second += 1;
-	  }
-	  else {
-	    prevFrequencies[index][ps] = 1;
-	  }
-	}
-      }
-    }
+    countTokens(_tokens,*_text,_tagset,frequencies,prevFrequencies);
   }
   ////////////////////////////////////////////////////////////
   // End count frequencies
@@ -396,8 +457,9 @@ void NEDeco::PrintTrainingData(StringXML* text,const bool printClasses,
   else {
     if (printClasses)
       out << _tagset->classCount() << endl;
-    set<NamedEntity> ents; 
-    FindMatches();
+    // only mark the tokens: the entities are not used, and a decorator
+    // reused for many files would keep them all
+    FindMatches(false);
     // obtain feature vectors for each token
     vector<FeatureVector> fvectors = (*_feature_handler)(_tokens,*_text,false);
     // for each token
@@ -406,13 +468,11 @@ void NEDeco::PrintTrainingData(StringXML* text,const bool printClasses,
     for (vector<FeatureVector>::const_iterator fvec=fvectors.begin();
 	 fvec!=fvectors.end();fvec++) {
       double d = 0;
-      token->getInfo("maxProb",d);
+      token->getInfo(maxProbInfo,d);
       int c = static_cast<int>(d);
       unsigned int weight = 0;
       // for each category (class)
       // print the class of the current token
-      StringXML s(token->getBeginIterator(_text->begin()),
-		  token->getEndIterator(_text->begin()));
       out << c << " @ ";
       for (int i = 0; i<_tagset->classCount();i++) {
 	// determine the weight of the current category
@@ -430,12 +490,11 @@ void NEDeco::PrintTrainingData(StringXML* text,const bool printClasses,
 	  //    cerr << f << ":" << feat->getValue() << endl;
 	  //}
 	  /////////////// END DEBUG ////////////////
-	  // generate name of current feature - category dependent
+	  // print the name of the current feature, which is category
+	  // dependent, and its value
 	  if (feat->getValue()!=0) {
-	    stringstream ss;
-	    ss << "cat" << i << "_" << feat->getFeature();
-	    // print feature and value
-	    out << ss.str() << " " << feat->getValue() << " ";
+	    out << "cat" << i << "_" << feat->getFeature() << " "
+		<< feat->getValue() << " ";
 	  }
 	} // finished for a feature
 	out << "# ";
@@ -446,6 +505,18 @@ void NEDeco::PrintTrainingData(StringXML* text,const bool printClasses,
   } 
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// 'CountFrequencies' counts the tokens of the given string into hash tables
+////////////////////////////////////////////////////////////////////////////////
+void NEDeco::CountFrequencies(StringXML* text,
+    vector<FrequencyTable>& frequencies,
+    vector<FrequencyTable>& prevFrequencies) {
+  _text = text;
+  _tokens = tokeniseWithNEInfo(_text->begin(),_text->end(),_tagset,
+      _document);
+  countTokens(_tokens,*_text,_tagset,frequencies,prevFrequencies);
+}
+
 void
 NEDeco::FindMatches(const bool createEntities) {
   FindRegexMatches(createEntities);
@@ -458,15 +529,16 @@ NEDeco::FindMatches(const bool createEntities) {
 ////////////////////////////////////////////////////////////////////////////////
 void
 NEDeco::FindRegexMatches(const bool createEntities) {
+  // find the matches of all the regexes at once
+  vector<vector<RegexMatch> > matches;
+  _regex_handler->Search(*_text,matches);
   // for each regex in the regex handler
   int j = 0;
   for (map<regex,EntityTag>::const_iterator i=_regex_handler->begin();
       i!=_regex_handler->end();i++) {
-    stringstream ss;
-    // the name of the current regex
-    ss << "regex" << j;
-    StringXML rxname = ss.str();
-    FindRegex(i->first,&(i->second),rxname,createEntities);
+    // marked with the information of the current regex
+    FindRegex(matches[j],&(i->second),infoSlot(_regexInfo,"regex",j),
+        createEntities);
     j++;
   }
 }
@@ -519,19 +591,16 @@ void NEDeco::refineEntities(const set<NamedEntity>& old,set<NamedEntity>& ref) {
 
 ////////////////////////////////////////////////////////////////////////////////
 // addTokenProbs takes an iterator to a TokenDeco and a vector of
-// probabilities and modifies the info map of the token to contain the
-// probability information.
+// probabilities and modifies the info of the token to contain the
+// probability information, in the slots given for each class.
 ////////////////////////////////////////////////////////////////////////////////
 void addTokenProbs(const vector<TokenDeco>::iterator& token,
-    const vector<double>& probs){
+    const vector<double>& probs,const vector<int>& probInfo){
   int i = 0;          // current probablitity
   // for each classification
   for (vector<double>::const_iterator ite=probs.begin();
       ite!=probs.end();ite++){
-    stringstream ss;
-    ss << "prob" << i;              // generate info name
-    StringXML name = ss.str();
-    token->setInfo(name,*ite);      // add to info map
+    token->setInfo(infoSlot(probInfo,"prob",i),*ite);  // add to info
     i++;
   }
 }
@@ -613,18 +682,33 @@ getCandidateClasses(const vector<double>& results, const int num=1) {
 // candidate
 ////////////////////////////////////////////////////////////////////////////////
 void NEDeco::FindClassified() {
-  // base classifier so no need to re-read modelfile
-  MaxEnt base_classifier(_tagset->classCount(),_modelFile);
+  // scratch space for the classifier, reused for every token
+  MaxEntBuffer buffer;
+  // unless a feature depends on the classification of previous tokens, all
+  // the tokens are classified at once
+  const bool batch=!_feature_handler->usesClassification();
+  const size_t classCount=_tagset->classCount();
+  vector<double> probabilities;
+  if (batch) {
+    _model->classify((*_feature_handler)(_tokens,*_text),probabilities,
+        buffer);
+  }
+  vector<double> results(classCount);
   set<EntBuffer> previous;
   set<EntBuffer> current;
   // for each token
   for (vector<TokenDeco>::iterator token=_tokens.begin();
         token!=_tokens.end();token++) {
-    // get a classifier
-    MaxEnt classifier=base_classifier;
-    FeatureVector featVec = (*_feature_handler)(_tokens,token,*_text);
-    vector<double> results=classifier.classify(featVec);
-    addTokenProbs(token,results);
+    if (batch) {
+      vector<double>::const_iterator row=probabilities.begin()+
+          (token-_tokens.begin())*classCount;
+      copy(row,row+classCount,results.begin());
+    }
+    else {
+      FeatureVector featVec = (*_feature_handler)(_tokens,token,*_text);
+      results=_model->classify(featVec,buffer);
+    }
+    addTokenProbs(token,results,_probInfo);
     //vector<double>::const_iterator o = 
     //    max_element(results.begin(),results.end());
     vector<pair<int,double> > poss =
@@ -713,56 +797,82 @@ void NEDeco::FindClassified() {
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// 'FindRegex' finds any entity that matches a regular expression, using the 
-// type provided.
+// 'mergeIntervals' sorts the closed intervals of offsets given and merges
+// those that overlap or touch, dropping the empty ones.  'inIntervals' tells
+// if an offset lies in one of the intervals merged.
+////////////////////////////////////////////////////////////////////////////////
+static void
+mergeIntervals(vector<pair<int,int> >& intervals) {
+  sort(intervals.begin(),intervals.end());
+  vector<pair<int,int> > merged;
+  for (vector<pair<int,int> >::const_iterator i=intervals.begin();
+      i!=intervals.end();i++) {
+    if (i->second<i->first) {
+      continue;
+    }
+    if (!merged.empty() && i->first<=merged.back().second+1) {
+      merged.back().second=max(merged.back().second,i->second);
+    }
+    else {
+      merged.push_back(*i);
+    }
+  }
+  intervals.swap(merged);
+}
+
+static bool
+inIntervals(const vector<pair<int,int> >& intervals,const int offset) {
+  // the last interval starting at or before the offset
+  vector<pair<int,int> >::const_iterator i=upper_bound(intervals.begin(),
+      intervals.end(),make_pair(offset,INT_MAX));
+  return i!=intervals.begin() && offset<=(i-1)->second;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 'FindRegex' creates the entities of the matches of a regular expression,
+// using the type provided.
 // Marks the tokens with the regular expression matched
 ////////////////////////////////////////////////////////////////////////////////
-void NEDeco::FindRegex(const regex& regx, const EntityTag* tag,
-    const StringXML& regexName,bool createEntities) {
-  // create iterators
-  StringXML::const_iterator start, end;
-  start = _text->begin();
-  end = _text->end();
-  // create result list, expression, flags
-  match_results<StringXML::const_iterator> what;
-  match_flag_type flags = match_default;
+void NEDeco::FindRegex(const vector<RegexMatch>& found, const EntityTag* tag,
+    const int regexInfo,bool createEntities) {
   vector<pair<int,int> > matches;
-  // find the matches
-  while (regex_search(start,end,what,regx,flags)){
+  for (vector<RegexMatch>::const_iterator what=found.begin();
+      what!=found.end();what++) {
     if (createEntities) {
-      NamedEntity ent(_text->begin(),what[0].first,
-        what[5].first,tag,1.0,"regex");
+      NamedEntity ent(_text->begin(),(*what)[0].first,
+        (*what)[5].first,tag,1.0,"regex");
       _entities.insert(ent);
     }
     pair<int,int> match;
-    match.first = what[0].first - _text->begin();
-    match.second = what[5].first - _text->begin();
+    match.first = (*what)[0].first - _text->begin();
+    match.second = (*what)[5].first - _text->begin();
     matches.push_back(match);
-    start = what[0].second;
-    flags |= match_prev_avail;
-    flags |= match_not_bob;
   }
-  // for each token, check if a match
+  if (matches.empty()) {
+    return;
+  }
+  // a token is marked if it begins within a match, ends included, or ends
+  // within it, beginning excluded
+  vector<pair<int,int> > begins(matches);
+  vector<pair<int,int> > ends;
+  for (vector<pair<int,int> >::const_iterator match=matches.begin();
+      match!=matches.end();match++) {
+    ends.push_back(make_pair(match->first+1,match->second));
+  }
+  mergeIntervals(begins);
+  mergeIntervals(ends);
   for (vector<TokenDeco>::iterator token=_tokens.begin();
       token!=_tokens.end();token++) {
-    // iterate through matches
-    for (vector<pair<int,int> >::const_iterator match=matches.begin();
-        match!=matches.end();match++) {
-      int b = token->getBegin();
-      int e = token->getEnd();
-      // if token offsets lie within match offsets
-      if (((b>=match->first)&&(b<=match->second))||
-           (e<=match->second)&&(e>match->first)) {
-        // set the token field
-        token->setInfo(regexName,1.0);
-      }
+    if (inIntervals(begins,token->getBegin()) ||
+        inIntervals(ends,token->getEnd())) {
+      token->setInfo(regexInfo,1.0);
     }
   }
 }
 
 // marks tokens pointed to by the iterators in the given vector
 void markTokens(vector<vector<TokenDeco>::iterator>& toks,
-    const StringXML& info,const StringXML& text) {
+    const int info,const StringXML& text) {
   for (vector<vector<TokenDeco>::iterator>::iterator i = toks.begin();
       i!=toks.end();i++) {
     (*i)->setInfo(info,1.0);
@@ -771,27 +881,47 @@ void markTokens(vector<vector<TokenDeco>::iterator>& toks,
 
 void
 NEDeco::FindListMatches(bool createEntities) {
+  // the gazetteer finds all the entries in one pass
+  if (_list_handler->UsesTrie()) {
+    vector<GazetteerMatch> matches;
+    _list_handler->GetGazetteer().match(_tokens,*_text,matches);
+    for (vector<GazetteerMatch>::const_iterator m=matches.begin();
+        m!=matches.end();m++) {
+      vector<vector<TokenDeco>::iterator> mark;
+      for (size_t t=m->first;t<=m->last;t++) {
+        mark.push_back(_tokens.begin()+t);
+      }
+      markTokens(mark,infoSlot(_listInfo,"list",m->list),*_text);
+      if (createEntities) {
+        NamedEntity ent(_text->begin(),
+            _tokens[m->first].getBeginIterator(_text->begin()),
+            _tokens[m->last].getEndIterator(_text->begin()),
+            _list_handler->GetTag(m->list),1.0,"list");
+        _entities.insert(ent);
+      }
+    }
+    return;
+  }
   // for each token
   for(vector<TokenDeco>::iterator token = _tokens.begin();
       token!=_tokens.end();token++) {
     // a vector of iterators to store which tokens to mark
     vector<vector<TokenDeco>::iterator> mark;
     mark.push_back(token);
-    StringXML txt(token->getBeginIterator(_text->begin()),
-        token->getEndIterator(_text->begin()));
+    // search for the token, extending the search token by token
+    ListCursor cursor=_list_handler->StartSearch();
     // get incomplete matches
-    vector<int> locs=_list_handler->FindString(txt,false);
-    bool go=(locs.size()>0);
+    bool go=_list_handler->ExtendSearch(cursor,
+        token->getBeginIterator(_text->begin()),
+        token->getEndIterator(_text->begin()));
     vector<TokenDeco>::iterator latest=token;
     while(go) {
       go=false;
       // get complete matches
-      locs=_list_handler->FindString(txt);
+      vector<int> locs=_list_handler->CompleteLists(cursor);
       // for each complete match, set info of tokens, create entity
       for (unsigned int i=0;i<locs.size();i++) {
-        stringstream ss;
-        ss << "list" << locs[i];
-        markTokens(mark,ss.str(),*_text);
+        markTokens(mark,infoSlot(_listInfo,"list",locs[i]),*_text);
         if (createEntities) {
           // create entity here, from all tokens that form ent
           NamedEntity ent(_text->begin(),
@@ -806,12 +936,13 @@ NEDeco::FindListMatches(bool createEntities) {
       next_token++;
       // if on last token, stop, else check next match
       if (next_token!=_tokens.end()) {
-        // set the text to be from the start token to end
-        txt.assign(token->getBeginIterator(_text->begin()),
-            next_token->getEndIterator(_text->begin()));
-        locs=_list_handler->FindString(txt,false);
+        // extend the text up to the end of the next token
+        ListCursor next=cursor;
         // if there are matches with the next token, continue
-        if (locs.size()>0) {
+        if (_list_handler->ExtendSearch(next,
+            latest->getEndIterator(_text->begin()),
+            next_token->getEndIterator(_text->begin()))) {
+          cursor=next;
           // add next to list to mark
           mark.push_back(next_token);
           go=true;
@@ -36,7 +36,9 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <map>
 #include <iostream>
+#include <ext/hash_map>
 #include <boost/regex.hpp>
 #include "tokeniser.h"
 #include "tokenDeco.h"
@@ -53,11 +55,17 @@ using namespace boost;
 using namespace ns_suffixtree;
 using namespace AF;
 
+class MaxEnt;
+
 namespace AF {
 
+// the number of times each token was found (see NEDeco::CountFrequencies)
+typedef __gnu_cxx::hash_map<StringXML,int,hash_str> FrequencyTable;
+
 vector<TokenDeco>
 tokeniseWithNEInfo(const StringXML::const_iterator begin,
-    const StringXML::const_iterator end,const EntityTagset* tset);
+    const StringXML::const_iterator end,const EntityTagset* tset,
+    TokenDocument& document);
 
 class NamedEntity {
 
@@ -118,12 +126,19 @@ class NEDeco {
 public:
 /////////////////////////////////////////////////////////////////////
 // Constructor, accepts a StringXML, populates NEList
+// The model is loaded by the caller and shared by every document
+// decorated; it is only needed for classification.
 /////////////////////////////////////////////////////////////////////
   NEDeco(const EntityTagset* t,const RegexHandler* rh,const ListHandler* lh,
-      const FeatureHandler* fh,const StringXML& modelFile="",
+      const FeatureHandler* fh,const MaxEnt* model=0,
       const int maxLabels=1,const int context=0,
       const bool singleLabels=false);
 /////////////////////////////////////////////////////////////////////
+// Copy constructor: the copy has its own copy of the tokens'
+// information.
+/////////////////////////////////////////////////////////////////////
+  NEDeco(const NEDeco& other);
+/////////////////////////////////////////////////////////////////////
 // Iterators pointing to the 'NamedEntity's stored in _entities.
 /////////////////////////////////////////////////////////////////////
   set<NamedEntity>::const_iterator begin();
@@ -155,6 +170,15 @@ public:
       vector<map<StringXML,int> >& prevFrequencies,
       const bool countFrequencies=true);
 
+/////////////////////////////////////////////////////////////////////
+// 'CountFrequencies' counts the tokens of the annotated text given,
+// as the counting mode of 'PrintTrainingData' does, but into hash
+// tables, so that counts for parts of a corpus can be made apart
+// and merged.
+/////////////////////////////////////////////////////////////////////
+  void CountFrequencies(StringXML* text,vector<FrequencyTable>& frequencies,
+      vector<FrequencyTable>& prevFrequencies);
+
   private:
   
   void FindMatches(bool createEntities=true);
@@ -166,21 +190,30 @@ public:
   void FindClassified();
   
 /////////////////////////////////////////////////////////////////////
-// 'findRegex' accepts a boost::regex pattern, a StringXML
-//  a set<NamedEntity>, and a EntityType. Fills the given vector 
-// with NamedEntity objects of type given  for those found in the
-//  TextUnit that match the given pattern.
+// 'findRegex' accepts the matches of a regular expression in the
+//  TextUnit (see RegexHandler::Search) and a EntityType. Adds
+//  NamedEntity objects of type given for the matches, and marks the
+//  tokens they cover with the information in slot 'regexInfo'.
 /////////////////////////////////////////////////////////////////////
-  void FindRegex(const boost::regex& regex,const EntityTag* tag,
-      const StringXML& regexName,bool createEntities);
+  void FindRegex(const vector<RegexMatch>& matches,const EntityTag* tag,
+      const int regexInfo,bool createEntities);
 
   void  refineEntities(const set<NamedEntity>& old,set<NamedEntity>& ref);
+/////////////////////////////////////////////////////////////////////
+// Not implemented: the tokens would keep pointing to the
+// '_document' of the other NEDeco.
+/////////////////////////////////////////////////////////////////////
+  NEDeco& operator=(const NEDeco& other);
   
 /////////////////////////////////////////////////////////////////////
 // '_text' is the StringXML given when the NEDeco is created.
 /////////////////////////////////////////////////////////////////////
   StringXML* _text;
   vector<TokenDeco> _tokens;
+/////////////////////////////////////////////////////////////////////
+// '_document' stores the information of '_tokens'.
+/////////////////////////////////////////////////////////////////////
+  TokenDocument _document;
 ////////////////////////////////////////////////////////////////////////////////
 // The list of tags used by the decorator
 ////////////////////////////////////////////////////////////////////////////////
@@ -188,12 +221,19 @@ public:
   const RegexHandler* _regex_handler;
   const ListHandler* _list_handler;
   const FeatureHandler* _feature_handler;
-  const StringXML _modelFile;
+  const MaxEnt* _model;
 // The maximum number of labels to allow in classification
   const int _maxLabels;
   const int _context;
   const bool _singleLabels;
 /////////////////////////////////////////////////////////////////////
+// The slots of the token information set by the decorator: the
+// probability of each class, and the marks of each list and regex.
+/////////////////////////////////////////////////////////////////////
+  vector<int> _probInfo;
+  vector<int> _listInfo;
+  vector<int> _regexInfo;
+/////////////////////////////////////////////////////////////////////
 // '_entities' is a vector of NamedEntities that is filled when the
 // NEDeco is created.
 /////////////////////////////////////////////////////////////////////
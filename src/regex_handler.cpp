@@ -86,6 +86,7 @@ RegexHandler::RegexHandler(ifstream& ifs) {
       }
     }
   }
+  BuildScanner();
 }
 
 RegexHandler::RegexHandler() {
@@ -110,6 +111,72 @@ RegexHandler::RegexCount() const {
   return _pairs.size();
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// 'Search': the scanner gives, in order, every position where an expression
+// can start a match.  An expression is tried there only (match_continuous)
+// if its previous match ends at or before it; if it matches, it has found the
+// same match as its own regex_search would have, as that would have failed
+// at every earlier position.
+////////////////////////////////////////////////////////////////////////////////
+void
+RegexHandler::Search(const StringXML& text,
+    vector<vector<RegexMatch> >& matches) const {
+  matches.assign(_pairs.size(),vector<RegexMatch>());
+  const StringXML::const_iterator begin=text.begin();
+  const StringXML::const_iterator end=text.end();
+  RegexMatch what;
+  // the expressions the scanner does not support, in turn
+  vector<const regex*> scanned(_scanner.size(),0);
+  int j=0;
+  for (map<regex,EntityTag>::const_iterator i=_pairs.begin();
+      i!=_pairs.end();i++,j++) {
+    if (_scanned[j]>=0) {
+      scanned[_scanned[j]]=&i->first;
+      continue;
+    }
+    if (!_prefilters[j].maySearch(text.data(),text.data()+text.size())) {
+      continue;
+    }
+    StringXML::const_iterator start=begin;
+    match_flag_type flags=match_default;
+    while (regex_search(start,end,what,i->first,flags)) {
+      matches[j].push_back(what);
+      start=what[0].second;
+      flags|=match_prev_avail;
+      flags|=match_not_bob;
+    }
+  }
+  if (scanned.empty()) {
+    return;
+  }
+  // where the search for each expression of the scanner continues
+  vector<StringXML::const_iterator> next(scanned.size(),begin);
+  vector<int> index(scanned.size(),0);
+  for (size_t k=0;k<_scanned.size();k++) {
+    if (_scanned[k]>=0) {
+      index[_scanned[k]]=k;
+    }
+  }
+  vector<ScanCandidate> candidates;
+  _scanner.scan(text.data(),text.data()+text.size(),candidates);
+  for (vector<ScanCandidate>::const_iterator c=candidates.begin();
+      c!=candidates.end();c++) {
+    const StringXML::const_iterator at=begin+c->position;
+    match_flag_type flags=match_continuous;
+    if (at!=begin) {
+      flags|=match_prev_avail;
+      flags|=match_not_bob;
+    }
+    for (size_t k=0;k<scanned.size();k++) {
+      if ((c->expressions&(uint64_t(1)<<k)) && next[k]<=at &&
+          regex_search(at,end,what,*scanned[k],flags)) {
+        matches[index[k]].push_back(what);
+        next[k]=what[0].second;
+      }
+    }
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Input functions: these functions are used when the RegexHandler is created
 // to assist with reading the input file.
@@ -158,3 +225,26 @@ RegexHandler::SetRegex(const StringXML re,const StringXML tag) {
 }
 
 
+
+void
+RegexHandler::BuildScanner() {
+  _scanner=RegexScanner();
+  _scanned.clear();
+  _prefilters.clear();
+  for (map<regex,EntityTag>::const_iterator i=_pairs.begin();
+      i!=_pairs.end();i++) {
+    const bool icase=(i->first.flags()&regex::icase)!=0;
+    if (_scanner.add(i->first.str(),icase)) {
+      _scanned.push_back(_scanner.size()-1);
+    }
+    else {
+      _scanned.push_back(-1);
+    }
+    _prefilters.push_back(RegexPrefilter());
+    _prefilters.back().build(i->first.str(),icase);
+  }
+  if (!_scanner.compile()) {
+    _scanner=RegexScanner();
+    _scanned.assign(_pairs.size(),-1);
+  }
+}
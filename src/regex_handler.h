@@ -38,6 +38,7 @@
 #include <boost/regex.hpp>
 #include "xml_string.h"
 #include "entity_tag.h"
+#include "regex_scanner.h"
 
 using namespace std;
 using namespace boost;
@@ -45,6 +46,8 @@ using namespace AF;
 
 namespace AF {
 
+typedef match_results<StringXML::const_iterator> RegexMatch;
+
 ////////////////////////////////////////////////////////////////////////////////
 // The RegexHandler class stores mapping between regular expressions and 
 // EntityTag objects.
@@ -74,6 +77,15 @@ class RegexHandler {
     int
     RegexCount() const;
 
+////////////////////////////////////////////////////////////////////////////////
+// 'Search' finds the matches of every regular expression in 'text', in one
+// pass over the text.  matches[j] receives the matches of the j-th regular
+// expression (in the order of 'begin()'), each searched for from the end of
+// the previous one, exactly as a loop of regex_search calls would find them.
+////////////////////////////////////////////////////////////////////////////////
+    void
+    Search(const StringXML& text,vector<vector<RegexMatch> >& matches) const;
+
   private:
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -91,7 +103,21 @@ class RegexHandler {
     void
     SetRegex(const StringXML regex,const StringXML tag);
 
+////////////////////////////////////////////////////////////////////////////////
+// 'BuildScanner' compiles the regular expressions into a RegexScanner, used to
+// find the places where each of them can start a match.  Expressions the
+// scanner does not support are searched for on their own, in the texts that
+// have the literals their matches require.
+////////////////////////////////////////////////////////////////////////////////
+    void
+    BuildScanner();
+
     map<regex,EntityTag> _pairs;
+    RegexScanner _scanner;
+    // the expression of the scanner for each regular expression, or -1
+    vector<int> _scanned;
+    // the literals of each regular expression the scanner does not support
+    vector<RegexPrefilter> _prefilters;
     
 };
 
@@ -0,0 +1,1060 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: regex_scanner.cpp
+////////////////////////////////////////////////////////////////////////////////
+// This file contains the implementation of the RegexScanner class, and of the
+// parser that turns a regular expression into its reversed automaton.
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2008  Diego Molla-Aliod <diego@ics.mq.edu.au>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdlib>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <utility>
+#include <bitset>
+#include <algorithm>
+#include <stdint.h>
+#include "regex_scanner.h"
+#include "xml_string.h"
+
+using namespace std;
+using namespace AF;
+
+const size_t RegexScanner::maxExpressions;
+const size_t RegexScanner::maxStates;
+
+// the most states the automaton of all the expressions may have, and the
+// most times a counted repeat may repeat
+static const size_t maxNfaStates=200000;
+static const int maxRepeat=1000;
+// the most characters a set may have to be taken as literals
+static const size_t maxLiteralChars=16;
+
+namespace AF {
+
+////////////////////////////////////////////////////////////////////////////////
+// A node of the syntax tree of a regular expression: a character set, a
+// sequence of nodes, alternative nodes, a node repeated from 'min' to 'max'
+// times (-1 for no limit), or the empty string
+////////////////////////////////////////////////////////////////////////////////
+struct RegexNode {
+  enum Type {CHARS,SEQUENCE,ALTERNATIVES,REPEAT,EMPTY};
+  Type type;
+  bitset<256> chars;
+  vector<int> children;
+  int min;
+  int max;
+  RegexNode(const Type t):type(t),min(0),max(0) {};
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// The literals, lower case, of a node of the syntax tree: all the texts the
+// node can match, if there are few enough, or literals one of which is in
+// every match, or none known
+////////////////////////////////////////////////////////////////////////////////
+struct RegexLiterals {
+  enum Kind {EXACT,REQUIRED,NONE};
+  Kind kind;
+  set<StringXML> strings;
+  RegexLiterals(const Kind k=NONE):kind(k) {};
+};
+
+static inline unsigned char
+foldCase(const unsigned char c) {
+  return (c>='A' && c<='Z')?c-'A'+'a':c;
+}
+
+// how much the literals filter: the length of the shortest, or -1 if they
+// do not filter at all
+static int
+literalsScore(const RegexLiterals& l) {
+  if (l.kind==RegexLiterals::NONE || l.strings.empty()) {
+    return -1;
+  }
+  int shortest=l.strings.begin()->size();
+  for (set<StringXML>::const_iterator i=l.strings.begin();
+      i!=l.strings.end();i++) {
+    shortest=min(shortest,static_cast<int>(i->size()));
+  }
+  return shortest==0?-1:shortest;
+}
+
+// keeps in 'required' whichever of it and 'other' filters better
+static void
+preferLiterals(RegexLiterals& required,const RegexLiterals& other) {
+  const int score=literalsScore(other);
+  const int current=literalsScore(required);
+  if (score>current || (score==current && score>=0 &&
+      other.strings.size()<required.strings.size())) {
+    required.kind=RegexLiterals::REQUIRED;
+    required.strings=other.strings;
+  }
+}
+
+// 'out' is every string of 'a' followed by one of 'b', unless there would
+// be too many
+static bool
+concatenateLiterals(const set<StringXML>& a,const set<StringXML>& b,
+    set<StringXML>& out) {
+  out.clear();
+  if (a.size()*b.size()>RegexPrefilter::maxLiterals) {
+    return false;
+  }
+  for (set<StringXML>::const_iterator i=a.begin();i!=a.end();i++) {
+    for (set<StringXML>::const_iterator j=b.begin();j!=b.end();j++) {
+      out.insert(*i+*j);
+    }
+  }
+  return true;
+}
+
+// drops the literals that contain another: a text with one of them has the
+// other too
+static void
+reduceLiterals(set<StringXML>& strings) {
+  set<StringXML> reduced;
+  for (set<StringXML>::const_iterator i=strings.begin();
+      i!=strings.end();i++) {
+    bool contains=false;
+    for (set<StringXML>::const_iterator j=strings.begin();
+        j!=strings.end() && !contains;j++) {
+      contains=(j!=i && i->find(*j)!=StringXML::npos);
+    }
+    if (!contains) {
+      reduced.insert(*i);
+    }
+  }
+  strings.swap(reduced);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// RegexParser
+// A recursive descent parser of the part of the boost perl syntax used by
+// the scanner.  Characters 128 to 255 are put in every class and escape, as
+// their classification and case depend on the locale.
+////////////////////////////////////////////////////////////////////////////////
+class RegexParser {
+public:
+  typedef RegexScanner::CharSet CharSet;
+
+  RegexParser(const StringXML& expression,const bool icase)
+      :_e(expression),_p(0),_icase(icase),_failed(false) {};
+
+  // 'parse' returns the root of the syntax tree, or -1 if the expression
+  // is not supported
+  int
+  parse() {
+    int root=alternatives();
+    if (_failed || _p!=_e.size()) {
+      return -1;
+    }
+    return root;
+  }
+
+  // 'build' adds the automaton of node 'n', reversed, to the scanner.
+  // Returns its start state and sets 'end' to its end state.
+  int
+  build(RegexScanner& s,const int n,int& end) const {
+    if (s._nfa.size()>maxNfaStates) { // too big, given up by the scanner
+      end=s.newState();
+      return end;
+    }
+    const RegexNode& node=_nodes[n];
+    switch (node.type) {
+    case RegexNode::CHARS: {
+      int start=s.newState();
+      end=s.newState();
+      s._nfa[start].chars=s.newSet(node.chars);
+      s._nfa[start].next=end;
+      return start;
+    }
+    case RegexNode::SEQUENCE: {
+      int start=s.newState();
+      end=start;
+      // reversed: the last child first
+      for (vector<int>::const_reverse_iterator c=node.children.rbegin();
+          c!=node.children.rend();c++) {
+        int e;
+        int b=build(s,*c,e);
+        s._nfa[end].empty.push_back(b);
+        end=e;
+      }
+      return start;
+    }
+    case RegexNode::ALTERNATIVES: {
+      int start=s.newState();
+      end=s.newState();
+      for (vector<int>::const_iterator c=node.children.begin();
+          c!=node.children.end();c++) {
+        int e;
+        int b=build(s,*c,e);
+        s._nfa[start].empty.push_back(b);
+        s._nfa[e].empty.push_back(end);
+      }
+      return start;
+    }
+    case RegexNode::REPEAT: {
+      int start=s.newState();
+      end=start;
+      for (int i=0;i<node.min;i++) {
+        int e;
+        int b=build(s,node.children[0],e);
+        s._nfa[end].empty.push_back(b);
+        end=e;
+      }
+      if (node.max<0) {
+        int loop=s.newState();
+        s._nfa[end].empty.push_back(loop);
+        int e;
+        int b=build(s,node.children[0],e);
+        s._nfa[loop].empty.push_back(b);
+        s._nfa[e].empty.push_back(loop);
+        end=loop;
+      }
+      else {
+        for (int i=node.min;i<node.max;i++) {
+          int out=s.newState();
+          int e;
+          int b=build(s,node.children[0],e);
+          s._nfa[end].empty.push_back(b);
+          s._nfa[end].empty.push_back(out);
+          s._nfa[e].empty.push_back(out);
+          end=out;
+        }
+      }
+      return start;
+    }
+    default:
+      end=s.newState();
+      return end;
+    }
+  }
+
+  // 'literals' finds the literals of node 'n'.  Assertions are taken to
+  // always hold, so the texts found may be more than the node matches.
+  void
+  literals(const int n,RegexLiterals& l) const {
+    const RegexNode& node=_nodes[n];
+    l.kind=RegexLiterals::EXACT;
+    l.strings.clear();
+    switch (node.type) {
+    case RegexNode::CHARS:
+      for (int b=0;b<256;b++) {
+        if (node.chars[b]) {
+          l.strings.insert(StringXML(1,foldCase(b)));
+        }
+      }
+      if (l.strings.empty() || l.strings.size()>maxLiteralChars) {
+        l.kind=RegexLiterals::NONE;
+        l.strings.clear();
+      }
+      return;
+    case RegexNode::SEQUENCE: {
+      // the texts of the children since the last one without, and the
+      // best literals before
+      RegexLiterals run(RegexLiterals::EXACT);
+      run.strings.insert("");
+      RegexLiterals required;
+      bool exact=true;
+      for (vector<int>::const_iterator c=node.children.begin();
+          c!=node.children.end();c++) {
+        RegexLiterals child;
+        literals(*c,child);
+        if (child.kind==RegexLiterals::EXACT) {
+          set<StringXML> joined;
+          if (concatenateLiterals(run.strings,child.strings,joined)) {
+            run.strings.swap(joined);
+            continue;
+          }
+          preferLiterals(required,run);
+          run=child;
+        }
+        else {
+          preferLiterals(required,run);
+          preferLiterals(required,child);
+          run.strings.clear();
+          run.strings.insert("");
+        }
+        exact=false;
+      }
+      if (exact) {
+        l=run;
+        return;
+      }
+      preferLiterals(required,run);
+      l=required;
+      return;
+    }
+    case RegexNode::ALTERNATIVES: {
+      // a match has the literals of one of the alternatives
+      for (vector<int>::const_iterator c=node.children.begin();
+          c!=node.children.end();c++) {
+        RegexLiterals child;
+        literals(*c,child);
+        if (child.kind==RegexLiterals::NONE) {
+          l.kind=RegexLiterals::NONE;
+          l.strings.clear();
+          return;
+        }
+        if (child.kind==RegexLiterals::REQUIRED) {
+          l.kind=RegexLiterals::REQUIRED;
+        }
+        l.strings.insert(child.strings.begin(),child.strings.end());
+      }
+      if (l.kind==RegexLiterals::EXACT && l.strings.size()<=
+          RegexPrefilter::maxLiterals) {
+        return;
+      }
+      reduceLiterals(l.strings);
+      l.kind=RegexLiterals::REQUIRED;
+      if (literalsScore(l)<0 || l.strings.size()>RegexPrefilter::maxLiterals) {
+        l.kind=RegexLiterals::NONE;
+        l.strings.clear();
+      }
+      return;
+    }
+    case RegexNode::REPEAT: {
+      RegexLiterals child;
+      literals(node.children[0],child);
+      if (node.max==0) {
+        l.strings.insert("");
+        return;
+      }
+      if (child.kind==RegexLiterals::EXACT) {
+        if (node.min==0 && node.max==1 &&
+            child.strings.size()<RegexPrefilter::maxLiterals) {
+          l.strings=child.strings;
+          l.strings.insert("");
+          return;
+        }
+        if (node.min==node.max) {
+          l.strings.insert("");
+          set<StringXML> joined;
+          int i=0;
+          while (i<node.min &&
+              concatenateLiterals(l.strings,child.strings,joined)) {
+            l.strings.swap(joined);
+            i++;
+          }
+          if (i==node.min) {
+            return;
+          }
+        }
+      }
+      // a match has the literals of the node repeated, if it is repeated
+      l.kind=RegexLiterals::NONE;
+      l.strings.clear();
+      if (node.min>0) {
+        preferLiterals(l,child);
+      }
+      return;
+    }
+    default:
+      l.strings.insert("");
+      return;
+    }
+  }
+
+private:
+  int
+  newNode(const RegexNode::Type type) {
+    _nodes.push_back(RegexNode(type));
+    return _nodes.size()-1;
+  }
+
+  bool
+  more() const {
+    return _p<_e.size();
+  }
+
+  int
+  fail() {
+    _failed=true;
+    return newNode(RegexNode::EMPTY);
+  }
+
+  // alternatives := sequence ('|' sequence)*
+  int
+  alternatives() {
+    int n=newNode(RegexNode::ALTERNATIVES);
+    int s=sequence();
+    _nodes[n].children.push_back(s);
+    while (!_failed && more() && _e[_p]=='|') {
+      _p++;
+      s=sequence();
+      _nodes[n].children.push_back(s);
+    }
+    return n;
+  }
+
+  // sequence := (atom quantifier*)*
+  int
+  sequence() {
+    int n=newNode(RegexNode::SEQUENCE);
+    while (!_failed && more() && _e[_p]!='|' && _e[_p]!=')') {
+      const char c=_e[_p];
+      if (c=='*' || c=='+' || c=='?' || c=='{') { // nothing to repeat
+        return fail();
+      }
+      int a=atom();
+      while (!_failed && more()) {
+        int min;
+        int max;
+        if (!quantifier(min,max)) {
+          break;
+        }
+        int r=newNode(RegexNode::REPEAT);
+        _nodes[r].children.push_back(a);
+        _nodes[r].min=min;
+        _nodes[r].max=max;
+        a=r;
+      }
+      _nodes[n].children.push_back(a);
+    }
+    return n;
+  }
+
+  // reads a quantifier, if there is one: *, +, ?, {m}, {m,} or {m,n},
+  // possibly lazy or possessive (which can only match less)
+  bool
+  quantifier(int& min,int& max) {
+    const char c=_e[_p];
+    if (c=='*') {
+      min=0;
+      max=-1;
+    }
+    else if (c=='+') {
+      min=1;
+      max=-1;
+    }
+    else if (c=='?') {
+      min=0;
+      max=1;
+    }
+    else if (c=='{') {
+      size_t q=_p+1;
+      if (!number(q,min)) {
+        fail();
+        return false;
+      }
+      max=min;
+      if (q<_e.size() && _e[q]==',') {
+        q++;
+        max=-1;
+        if (q<_e.size() && _e[q]!='}' && !number(q,max)) {
+          fail();
+          return false;
+        }
+      }
+      if (q>=_e.size() || _e[q]!='}' || min>maxRepeat || max>maxRepeat ||
+          (max>=0 && max<min)) {
+        fail();
+        return false;
+      }
+      _p=q;
+    }
+    else {
+      return false;
+    }
+    _p++;
+    if (more() && (_e[_p]=='?' || _e[_p]=='+')) {
+      _p++;
+    }
+    return true;
+  }
+
+  bool
+  number(size_t& q,int& value) {
+    size_t b=q;
+    value=0;
+    while (q<_e.size() && isdigit(static_cast<unsigned char>(_e[q])) &&
+        value<=maxRepeat) {
+      value=value*10+(_e[q]-'0');
+      q++;
+    }
+    return q>b;
+  }
+
+  int
+  atom() {
+    const char c=_e[_p++];
+    if (c=='(') {
+      return group();
+    }
+    if (c=='[') {
+      int n=newNode(RegexNode::CHARS);
+      if (!charClass(_nodes[n].chars)) {
+        return fail();
+      }
+      return n;
+    }
+    if (c=='^' || c=='$') { // anchors
+      return newNode(RegexNode::EMPTY);
+    }
+    int n=newNode(RegexNode::CHARS);
+    if (c=='.') {
+      _nodes[n].chars.set();
+      return n;
+    }
+    if (c=='\\') {
+      if (!more()) {
+        return fail();
+      }
+      bool assertion=false;
+      int single=-1;
+      if (!escape(_nodes[n].chars,single,false,assertion)) {
+        return fail();
+      }
+      if (assertion) {
+        return newNode(RegexNode::EMPTY);
+      }
+      if (single>=0) {
+        addChar(_nodes[n].chars,single);
+      }
+      return n;
+    }
+    addChar(_nodes[n].chars,static_cast<unsigned char>(c));
+    return n;
+  }
+
+  // after '(': (...), (?:...), (?>...), (?#...) and assertions
+  int
+  group() {
+    bool assertion=false;
+    if (more() && _e[_p]=='?') {
+      _p++;
+      if (!more()) {
+        return fail();
+      }
+      const char c=_e[_p];
+      if (c==':' || c=='>') {
+        _p++;
+      }
+      else if (c=='=' || c=='!') {
+        _p++;
+        assertion=true;
+      }
+      else if (c=='<' && _p+1<_e.size() &&
+          (_e[_p+1]=='=' || _e[_p+1]=='!')) {
+        _p+=2;
+        assertion=true;
+      }
+      else if (c=='#') {
+        size_t q=_e.find(')',_p);
+        if (q==StringXML::npos) {
+          return fail();
+        }
+        _p=q+1;
+        return newNode(RegexNode::EMPTY);
+      }
+      else { // modifiers, conditionals, named groups...
+        return fail();
+      }
+    }
+    int n=alternatives();
+    if (_failed || !more() || _e[_p]!=')') {
+      return fail();
+    }
+    _p++;
+    if (assertion) {
+      return newNode(RegexNode::EMPTY);
+    }
+    return n;
+  }
+
+  // after '[': a set of characters up to ']'
+  bool
+  charClass(CharSet& set) {
+    bool negate=false;
+    if (more() && _e[_p]=='^') {
+      negate=true;
+      _p++;
+    }
+    bool first=true;
+    while (more() && (_e[_p]!=']' || first)) {
+      first=false;
+      unsigned char low=_e[_p];
+      if (low=='[' && _p+1<_e.size() &&
+          (_e[_p+1]==':' || _e[_p+1]=='.' || _e[_p+1]=='=')) {
+        return false; // character classes and collating elements
+      }
+      _p++;
+      if (low=='\\') {
+        if (!more()) {
+          return false;
+        }
+        bool assertion=false;
+        int single=-1;
+        if (!escape(set,single,true,assertion)) {
+          return false;
+        }
+        if (single<0) { // \d, \s, \w...
+          continue;
+        }
+        low=single;
+      }
+      // a range
+      if (_p+1<_e.size() && _e[_p]=='-' && _e[_p+1]!=']') {
+        _p++;
+        unsigned char high=_e[_p++];
+        if (high=='\\') {
+          if (!more()) {
+            return false;
+          }
+          CharSet escaped;
+          bool assertion=false;
+          int single=-1;
+          if (!escape(escaped,single,true,assertion) || single<0) {
+            return false;
+          }
+          high=single;
+        }
+        if (high<low) {
+          return false;
+        }
+        for (int b=low;b<=high;b++) {
+          addChar(set,b);
+        }
+      }
+      else {
+        addChar(set,low);
+      }
+    }
+    if (!more()) {
+      return false;
+    }
+    _p++;
+    if (negate) {
+      set.flip();
+      for (int b=128;b<256;b++) {
+        set.set(b);
+      }
+    }
+    return true;
+  }
+
+  // after '\': sets 'single' to the character escaped, adds the class of
+  // characters of the escape (\d, \s...) to 'set', or sets 'assertion' for
+  // \b, \A, \z...
+  bool
+  escape(CharSet& set,int& single,const bool inClass,bool& assertion) {
+    const unsigned char c=_e[_p++];
+    CharSet ascii;
+    switch (c) {
+    case 'd': case 'D':
+      for (int b='0';b<='9';b++) {
+        ascii.set(b);
+      }
+      break;
+    case 's': case 'S':
+      ascii.set(' ');
+      ascii.set('\t');
+      ascii.set('\n');
+      ascii.set('\v');
+      ascii.set('\f');
+      ascii.set('\r');
+      break;
+    case 'w': case 'W':
+      for (int b=0;b<128;b++) {
+        if (isalnum(b) || b=='_') {
+          ascii.set(b);
+        }
+      }
+      break;
+    case 'b':
+      if (inClass) {
+        single='\b';
+        return true;
+      }
+      assertion=true;
+      return true;
+    case 'B': case 'A': case 'z': case 'Z': case 'G': case '<': case '>':
+    case '`': case '\'':
+      if (inClass) {
+        return false;
+      }
+      assertion=true;
+      return true;
+    case 'n': single='\n'; return true;
+    case 't': single='\t'; return true;
+    case 'r': single='\r'; return true;
+    case 'f': single='\f'; return true;
+    case 'v': single='\v'; return true;
+    case 'a': single='\a'; return true;
+    case 'e': single=27; return true;
+    case 'x': {
+      int value=0;
+      int digits=0;
+      while (digits<2 && more() && isxdigit(static_cast<unsigned char>(_e[_p]))) {
+        const char h=tolower(_e[_p++]);
+        value=value*16+(isdigit(h)?h-'0':h-'a'+10);
+        digits++;
+      }
+      if (digits==0) {
+        return false;
+      }
+      single=value;
+      return true;
+    }
+    default:
+      if (isalnum(c)) { // back references and other escapes
+        return false;
+      }
+      single=c;
+      return true;
+    }
+    if (isupper(c)) {
+      ascii.flip();
+    }
+    else {
+      for (int b=128;b<256;b++) {
+        ascii.set(b);
+      }
+    }
+    set|=ascii;
+    return true;
+  }
+
+  // adds a character, and its other case if case is ignored
+  void
+  addChar(CharSet& set,const int c) const {
+    set.set(c);
+    if (!_icase) {
+      return;
+    }
+    if (c<128) {
+      set.set(tolower(c));
+      set.set(toupper(c));
+    }
+    else {
+      for (int b=128;b<256;b++) {
+        set.set(b);
+      }
+    }
+  }
+
+  const StringXML& _e;
+  size_t _p;
+  bool _icase;
+  bool _failed;
+  vector<RegexNode> _nodes;
+};
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+////////////////////////////////////////////////////////////////////////////////
+RegexScanner::RegexScanner():_classes(0),_compiled(false) {
+}
+
+int
+RegexScanner::newState() {
+  _nfa.push_back(NfaState());
+  return _nfa.size()-1;
+}
+
+int
+RegexScanner::newSet(const CharSet& set) {
+  // most sets are single characters, used many times
+  for (size_t i=_sets.size();i>0 && i+64>_sets.size();i--) {
+    if (_sets[i-1]==set) {
+      return i-1;
+    }
+  }
+  _sets.push_back(set);
+  return _sets.size()-1;
+}
+
+bool
+RegexScanner::add(const StringXML& expression,const bool icase) {
+  if (_starts.size()>=maxExpressions) {
+    return false;
+  }
+  RegexParser parser(expression,icase);
+  int root=parser.parse();
+  if (root<0) {
+    return false;
+  }
+  const size_t states=_nfa.size();
+  const size_t sets=_sets.size();
+  int end;
+  int start=parser.build(*this,root,end);
+  if (_nfa.size()>maxNfaStates) {
+    _nfa.resize(states);
+    _sets.resize(sets);
+    return false;
+  }
+  // reversed, the automaton accepts where the expression starts
+  _nfa[end].accept=_starts.size();
+  _starts.push_back(start);
+  _compiled=false;
+  return true;
+}
+
+void
+RegexScanner::closure(vector<int>& states,vector<unsigned int>& mark,
+    unsigned int& generation) const {
+  generation++;
+  vector<int> stack;
+  for (vector<int>::const_iterator s=states.begin();s!=states.end();s++) {
+    if (mark[*s]!=generation) {
+      mark[*s]=generation;
+      stack.push_back(*s);
+    }
+  }
+  states.clear();
+  while (!stack.empty()) {
+    const int s=stack.back();
+    stack.pop_back();
+    const NfaState& state=_nfa[s];
+    if (state.chars>=0 || state.accept>=0) {
+      states.push_back(s);
+    }
+    for (vector<int>::const_iterator e=state.empty.begin();
+        e!=state.empty.end();e++) {
+      if (mark[*e]!=generation) {
+        mark[*e]=generation;
+        stack.push_back(*e);
+      }
+    }
+  }
+  sort(states.begin(),states.end());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 'compile': the characters are first split into classes that no character
+// set tells apart.  The states of the deterministic automaton are the sets
+// of states the reversed expressions can be in, always including their
+// start states, since a match may start (i.e. end, reversed) anywhere.
+////////////////////////////////////////////////////////////////////////////////
+bool
+RegexScanner::compile() {
+  _compiled=false;
+  // split the characters into classes
+  vector<int> classOf(256,0);
+  _classes=1;
+  for (vector<CharSet>::const_iterator set=_sets.begin();
+      set!=_sets.end();set++) {
+    // the new class of each old class and membership of the set
+    vector<int> refined(2*_classes,-1);
+    size_t classes=0;
+    for (int b=0;b<256;b++) {
+      int& id=refined[2*classOf[b]+((*set)[b]?1:0)];
+      if (id<0) {
+        id=classes++;
+      }
+      classOf[b]=id;
+    }
+    _classes=classes;
+  }
+  vector<int> sample(_classes,0);
+  _classOf.assign(256,0);
+  for (int b=255;b>=0;b--) {
+    _classOf[b]=classOf[b];
+    sample[classOf[b]]=b;
+  }
+  // the classes in each set
+  vector<vector<int> > setClasses(_sets.size());
+  for (size_t set=0;set<_sets.size();set++) {
+    for (size_t c=0;c<_classes;c++) {
+      if (_sets[set][sample[c]]) {
+        setClasses[set].push_back(c);
+      }
+    }
+  }
+  // build the states breadth first.  Every state holds the start states,
+  // as an expression can start anywhere, so a state is kept, and known, by
+  // its other states only, and the moves of the start states are found once.
+  vector<unsigned int> mark(_nfa.size(),0);
+  unsigned int generation=0;
+  vector<int> start(_starts);
+  closure(start,mark,generation);
+  vector<bool> isStart(_nfa.size(),false);
+  uint64_t startAccepts=0;
+  vector<vector<int> > startMoves(_classes);
+  for (vector<int>::const_iterator s=start.begin();s!=start.end();s++) {
+    const NfaState& state=_nfa[*s];
+    isStart[*s]=true;
+    if (state.accept>=0) {
+      startAccepts|=uint64_t(1)<<state.accept;
+    }
+    if (state.chars>=0) {
+      const vector<int>& classes=setClasses[state.chars];
+      for (vector<int>::const_iterator c=classes.begin();
+          c!=classes.end();c++) {
+        startMoves[*c].push_back(state.next);
+      }
+    }
+  }
+  vector<vector<int> > states(1);
+  map<vector<int>,int> ids;
+  ids[states[0]]=0;
+  vector<vector<int> > moves(_classes);
+  _next.clear();
+  _accepts.clear();
+  for (size_t d=0;d<states.size();d++) {
+    uint64_t accepts=startAccepts;
+    // the states reached on each class, in one pass over the state
+    moves=startMoves;
+    for (vector<int>::const_iterator s=states[d].begin();
+        s!=states[d].end();s++) {
+      const NfaState& state=_nfa[*s];
+      if (state.accept>=0) {
+        accepts|=uint64_t(1)<<state.accept;
+      }
+      if (state.chars>=0) {
+        const vector<int>& classes=setClasses[state.chars];
+        for (vector<int>::const_iterator c=classes.begin();
+            c!=classes.end();c++) {
+          moves[*c].push_back(state.next);
+        }
+      }
+    }
+    _accepts.push_back(accepts);
+    for (size_t c=0;c<_classes;c++) {
+      vector<int>& moved=moves[c];
+      closure(moved,mark,generation);
+      vector<int> key;
+      for (vector<int>::const_iterator s=moved.begin();s!=moved.end();s++) {
+        if (!isStart[*s]) {
+          key.push_back(*s);
+        }
+      }
+      map<vector<int>,int>::const_iterator i=ids.find(key);
+      if (i!=ids.end()) {
+        _next.push_back(i->second);
+        continue;
+      }
+      if (states.size()>=maxStates) {
+        _next.clear();
+        _accepts.clear();
+        return false;
+      }
+      const int id=states.size();
+      ids[key]=id;
+      states.push_back(key);
+      _next.push_back(id);
+    }
+  }
+  _compiled=true;
+  return true;
+}
+
+void
+RegexScanner::scan(const char* begin,const char* end,
+    vector<ScanCandidate>& found) const {
+  const size_t first=found.size();
+  int state=0;
+  for (const char* p=end;p!=begin;) {
+    p--;
+    state=_next[state*_classes+_classOf[static_cast<unsigned char>(*p)]];
+    if (_accepts[state]!=0) {
+      found.push_back(ScanCandidate(p-begin,_accepts[state]));
+    }
+  }
+  reverse(found.begin()+first,found.end());
+}
+
+size_t
+RegexScanner::size() const {
+  return _starts.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// RegexPrefilter
+////////////////////////////////////////////////////////////////////////////////
+const size_t RegexPrefilter::maxLiterals;
+
+RegexPrefilter::RegexPrefilter():_filters(false) {
+}
+
+bool
+RegexPrefilter::build(const StringXML& expression,const bool icase) {
+  _literals.clear();
+  _first.clear();
+  _whole.clear();
+  _filters=false;
+  RegexParser parser(expression,icase);
+  int root=parser.parse();
+  if (root<0) {
+    return false;
+  }
+  RegexLiterals l;
+  parser.literals(root,l);
+  if (l.kind==RegexLiterals::NONE) {
+    return false;
+  }
+  if (l.kind==RegexLiterals::EXACT) {
+    _whole.assign(l.strings.begin(),l.strings.end());
+    _filters=true;
+  }
+  if (literalsScore(l)>0) {
+    reduceLiterals(l.strings);
+    _literals.assign(l.strings.begin(),l.strings.end());
+    _first.assign(256,vector<int>());
+    for (size_t i=0;i<_literals.size();i++) {
+      for (int b=0;b<256;b++) {
+        if (foldCase(b)==static_cast<unsigned char>(_literals[i][0])) {
+          _first[b].push_back(i);
+        }
+      }
+    }
+    _filters=true;
+  }
+  return _filters;
+}
+
+bool
+RegexPrefilter::maySearch(const char* begin,const char* end) const {
+  if (_literals.empty()) {
+    return true;
+  }
+  for (const char* p=begin;p!=end;p++) {
+    const vector<int>& starting=_first[static_cast<unsigned char>(*p)];
+    for (vector<int>::const_iterator i=starting.begin();
+        i!=starting.end();i++) {
+      const StringXML& literal=_literals[*i];
+      if (static_cast<size_t>(end-p)<literal.size()) {
+        continue;
+      }
+      size_t k=1;
+      while (k<literal.size() &&
+          foldCase(p[k])==static_cast<unsigned char>(literal[k])) {
+        k++;
+      }
+      if (k==literal.size()) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool
+RegexPrefilter::mayMatch(const char* begin,const char* end) const {
+  if (_whole.empty()) {
+    return maySearch(begin,end);
+  }
+  StringXML text(begin,end);
+  for (StringXML::iterator c=text.begin();c!=text.end();c++) {
+    *c=foldCase(*c);
+  }
+  return binary_search(_whole.begin(),_whole.end(),text);
+}
@@ -0,0 +1,194 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: regex_scanner.h
+////////////////////////////////////////////////////////////////////////////////
+// This file contains the definition of the RegexScanner class.
+// A RegexScanner finds, in a single pass over a text, the positions at which
+// each of a set of regular expressions can start a match.  The expressions
+// are reversed and compiled together into one deterministic automaton, which
+// reads the text backwards: after reading the text from the end down to a
+// position, it is in an accepting state of an expression exactly when some
+// text starting at that position matches the expression.
+// The scanner only tells where matches start; the match itself, with perl
+// semantics, is then found by boost::regex at those positions only.
+// It also contains the definition of the RegexPrefilter class, which finds
+// the literal strings any match of an expression must contain, so that texts
+// without them need not be searched at all.
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2008  Diego Molla-Aliod <diego@ics.mq.edu.au>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __regex_scanner__
+#define __regex_scanner__
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <utility>
+#include <bitset>
+#include <stdint.h>
+#include "xml_string.h"
+
+using namespace std;
+
+namespace AF {
+
+////////////////////////////////////////////////////////////////////////////////
+// The expressions that can start a match at 'position' (bit k set for the
+// k-th expression added)
+////////////////////////////////////////////////////////////////////////////////
+struct ScanCandidate {
+  size_t position;
+  uint64_t expressions;
+  ScanCandidate(const size_t p,const uint64_t e):position(p),expressions(e) {};
+};
+
+class RegexScanner {
+public:
+////////////////////////////////////////////////////////////////////////////////
+// At most 'maxExpressions' expressions can be added, and the automaton is
+// given up if it grows beyond 'maxStates' states
+////////////////////////////////////////////////////////////////////////////////
+  static const size_t maxExpressions=64;
+  static const size_t maxStates=20000;
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor: a scanner without expressions
+////////////////////////////////////////////////////////////////////////////////
+  RegexScanner();
+
+////////////////////////////////////////////////////////////////////////////////
+// 'add' adds a regular expression in boost perl syntax.  Returns false, and
+// adds nothing, if the expression uses syntax the scanner does not support
+// (e.g. back references or (?x) mode) or too many expressions were added.
+// Assertions (anchors, word boundaries, look-ahead and look-behind) are
+// taken to always hold, so such an expression may be reported where it
+// cannot match, but never the other way round.
+////////////////////////////////////////////////////////////////////////////////
+  bool
+  add(const StringXML& expression,const bool icase);
+
+////////////////////////////////////////////////////////////////////////////////
+// 'compile' builds the automaton of the expressions added.  Returns false if
+// the automaton would have more than 'maxStates' states.
+////////////////////////////////////////////////////////////////////////////////
+  bool
+  compile();
+
+////////////////////////////////////////////////////////////////////////////////
+// 'scan' reads the text from 'begin' to 'end' once and adds to 'found', by
+// increasing position, every position at which some expression can start a
+// match.  'compile' must have succeeded.
+////////////////////////////////////////////////////////////////////////////////
+  void
+  scan(const char* begin,const char* end,vector<ScanCandidate>& found) const;
+
+////////////////////////////////////////////////////////////////////////////////
+// 'size' returns the number of expressions added
+////////////////////////////////////////////////////////////////////////////////
+  size_t
+  size() const;
+
+private:
+  typedef bitset<256> CharSet;
+
+  // a state of the nondeterministic automaton: on a character of 'chars'
+  // it moves to 'next', and it moves to 'empty' without reading
+  struct NfaState {
+    int chars;
+    int next;
+    vector<int> empty;
+    int accept;  // the expression this state accepts, or -1
+    NfaState():chars(-1),next(-1),accept(-1) {};
+  };
+
+  int
+  newState();
+
+  int
+  newSet(const CharSet& set);
+
+////////////////////////////////////////////////////////////////////////////////
+// 'closure' adds to 'states' the states reached from them without reading,
+// then keeps only those that read a character or accept, sorted.  'mark'
+// and 'generation' record the states seen, so that they are reused.
+////////////////////////////////////////////////////////////////////////////////
+  void
+  closure(vector<int>& states,vector<unsigned int>& mark,
+      unsigned int& generation) const;
+
+  // the nondeterministic automaton, its character sets and the start state
+  // of each expression
+  vector<NfaState> _nfa;
+  vector<CharSet> _sets;
+  vector<int> _starts;
+  // the deterministic automaton: the class of each character, the next
+  // state of each state and class, and the expressions each state accepts
+  vector<unsigned char> _classOf;
+  size_t _classes;
+  vector<int32_t> _next;
+  vector<uint64_t> _accepts;
+  bool _compiled;
+
+  friend class RegexParser;
+};
+
+class RegexPrefilter {
+public:
+////////////////////////////////////////////////////////////////////////////////
+// At most 'maxLiterals' literals are kept for an expression
+////////////////////////////////////////////////////////////////////////////////
+  static const size_t maxLiterals=32;
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor: a prefilter that lets every text through
+////////////////////////////////////////////////////////////////////////////////
+  RegexPrefilter();
+
+////////////////////////////////////////////////////////////////////////////////
+// 'build' finds the literals of a regular expression in boost perl syntax.
+// Returns false, and lets every text through, if the expression is not
+// supported by the scanner or no literal is required.  Literals are compared
+// ignoring case whatever 'icase' is, which lets through more texts, never
+// fewer.
+////////////////////////////////////////////////////////////////////////////////
+  bool
+  build(const StringXML& expression,const bool icase);
+
+////////////////////////////////////////////////////////////////////////////////
+// 'maySearch' returns false if the text from 'begin' to 'end' contains no
+// match of the expression, as it contains none of the literals.  'mayMatch'
+// returns false if the whole text cannot match the expression.
+////////////////////////////////////////////////////////////////////////////////
+  bool
+  maySearch(const char* begin,const char* end) const;
+
+  bool
+  mayMatch(const char* begin,const char* end) const;
+
+private:
+  // the literals, lower case, one of which is in every match, and the
+  // literals starting with each character
+  vector<StringXML> _literals;
+  vector<vector<int> > _first;
+  // all the texts the expression can match, lower case and sorted, if there
+  // are few enough
+  vector<StringXML> _whole;
+  bool _filters;
+};
+
+}
+
+#endif
@@ -0,0 +1,134 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: scheduler.cpp
+////////////////////////////////////////////////////////////////////////////////
+// This file contains the implementation of the Scheduler class, which runs
+// independent jobs on a pool of work stealing threads.
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2008  Diego Molla-Aliod <diego@ics.mq.edu.au>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdlib>
+#include <deque>
+#include <string>
+#include <stdexcept>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include "scheduler.h"
+
+using namespace std;
+using namespace AF;
+
+ScheduledJobs::~ScheduledJobs() {
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+////////////////////////////////////////////////////////////////////////////////
+Scheduler::Scheduler(const unsigned int threads)
+    :_threads((threads>0)?threads:1),_failed(false),_ordered(false) {
+}
+
+unsigned int
+Scheduler::threads() const {
+  return _threads;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 'run' fills the queues with consecutive blocks of jobs, or deals the jobs
+// out in turn if they are ordered, and starts the threads.  With a single
+// thread the jobs are run in order, in the calling thread.
+////////////////////////////////////////////////////////////////////////////////
+void
+Scheduler::run(ScheduledJobs& jobs,const size_t count,const bool ordered) {
+  _queues.clear();
+  _failed=false;
+  _error="";
+  _ordered=ordered;
+  for (unsigned int w=0;w<_threads;w++) {
+    _queues.push_back(new Queue);
+  }
+  for (unsigned int w=0;w<_threads;w++) {
+    if (_ordered) {
+      for (size_t j=w;j<count;j+=_threads) {
+        _queues[w].jobs.push_back(j);
+      }
+    }
+    else {
+      for (size_t j=count*w/_threads;j<count*(w+1)/_threads;j++) {
+        _queues[w].jobs.push_back(j);
+      }
+    }
+  }
+  if (_threads==1) {
+    work(&jobs,0);
+  }
+  else {
+    boost::thread_group pool;
+    for (unsigned int w=0;w<_threads;w++) {
+      pool.create_thread(Worker(this,&jobs,w));
+    }
+    pool.join_all();
+  }
+  if (_failed) {
+    throw runtime_error(_error);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 'work' runs jobs until none are left, recording the first error
+////////////////////////////////////////////////////////////////////////////////
+void
+Scheduler::work(ScheduledJobs* jobs,const unsigned int worker) {
+  size_t job;
+  while (next(worker,job)) {
+    try {
+      jobs->run(job,worker);
+    }
+    catch (std::exception& e) {
+      boost::mutex::scoped_lock lock(_errorLock);
+      if (!_failed) {
+        _failed=true;
+        _error=e.what();
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 'next' takes a job from the front of the worker's own queue or, failing
+// that, steals one from the other queues in turn: the last job of a block,
+// or the earliest job if the jobs are ordered
+////////////////////////////////////////////////////////////////////////////////
+bool
+Scheduler::next(const unsigned int worker,size_t& job) {
+  for (unsigned int i=0;i<_threads;i++) {
+    const unsigned int victim=(worker+i)%_threads;
+    Queue& q=_queues[victim];
+    boost::mutex::scoped_lock lock(q.lock);
+    if (!q.jobs.empty()) {
+      if (victim==worker || _ordered) {
+        job=q.jobs.front();
+        q.jobs.pop_front();
+      }
+      else {
+        job=q.jobs.back();
+        q.jobs.pop_back();
+      }
+      return true;
+    }
+  }
+  return false;
+}
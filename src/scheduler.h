@@ -0,0 +1,129 @@
+////////////////////////////////////////////////////////////////////////////////
+// Filename: scheduler.h
+////////////////////////////////////////////////////////////////////////////////
+// This file contains the definition of the Scheduler class.
+// The Scheduler runs a number of independent jobs on a pool of threads.  Each
+// thread starts with its own queue of jobs and, once its queue is empty,
+// steals jobs from the queues of the other threads, so that threads given
+// shorter jobs do not sit idle.
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2008  Diego Molla-Aliod <diego@ics.mq.edu.au>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __scheduler__
+#define __scheduler__
+
+#include <cstdlib>
+#include <deque>
+#include <string>
+#include <boost/thread/mutex.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+using namespace std;
+
+namespace AF {
+
+////////////////////////////////////////////////////////////////////////////////
+// 'ScheduledJobs' is an abstract base class for a set of numbered jobs that
+// can be run in any order, by any thread.
+////////////////////////////////////////////////////////////////////////////////
+class ScheduledJobs {
+public:
+  virtual ~ScheduledJobs();
+
+////////////////////////////////////////////////////////////////////////////////
+// 'run' runs job number 'job'.  'worker' is the number of the thread running
+// it, so that each thread can be given its own data to work with.
+////////////////////////////////////////////////////////////////////////////////
+  virtual void
+  run(const size_t job,const unsigned int worker)=0;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// 'Scheduler' runs ScheduledJobs on a pool of threads
+////////////////////////////////////////////////////////////////////////////////
+class Scheduler {
+public:
+////////////////////////////////////////////////////////////////////////////////
+// Constructor: takes the number of threads to use (at least 1)
+////////////////////////////////////////////////////////////////////////////////
+  Scheduler(const unsigned int threads);
+
+////////////////////////////////////////////////////////////////////////////////
+// 'threads' returns the number of threads used
+////////////////////////////////////////////////////////////////////////////////
+  unsigned int
+  threads() const;
+
+////////////////////////////////////////////////////////////////////////////////
+// 'run' runs jobs 0 to count-1 and returns once all of them are done.  Jobs
+// are first split into consecutive blocks, one per thread.  If 'ordered' is
+// true they are dealt out in turn instead, and stolen from the front of the
+// queues, so that they finish roughly in order (e.g. when their output is
+// written in order).  If a job throws an exception the remaining jobs are
+// still run, and a runtime_error with the message of the first exception is
+// thrown once all threads are done.
+////////////////////////////////////////////////////////////////////////////////
+  void
+  run(ScheduledJobs& jobs,const size_t count,const bool ordered=false);
+
+private:
+  struct Queue {
+    deque<size_t> jobs;
+    boost::mutex lock;
+  };
+
+////////////////////////////////////////////////////////////////////////////////
+// 'Worker' is the function run by thread number 'worker' of the pool
+////////////////////////////////////////////////////////////////////////////////
+  struct Worker {
+    Scheduler* scheduler;
+    ScheduledJobs* jobs;
+    unsigned int worker;
+    Worker(Scheduler* s,ScheduledJobs* j,const unsigned int w)
+        :scheduler(s),jobs(j),worker(w) {};
+    void operator()() const {
+      scheduler->work(jobs,worker);
+    }
+  };
+  friend struct Worker;
+
+////////////////////////////////////////////////////////////////////////////////
+// 'work' runs jobs in thread number 'worker' until there are none left
+////////////////////////////////////////////////////////////////////////////////
+  void
+  work(ScheduledJobs* jobs,const unsigned int worker);
+
+////////////////////////////////////////////////////////////////////////////////
+// 'next' takes the next job for thread number 'worker', from the front of
+// its own queue or else from another thread's queue (from the back, or from
+// the front when running ordered jobs).  Returns false if there are no jobs
+// left.
+////////////////////////////////////////////////////////////////////////////////
+  bool
+  next(const unsigned int worker,size_t& job);
+
+  const unsigned int _threads;
+  boost::ptr_vector<Queue> _queues;
+  boost::mutex _errorLock;
+  string _error;
+  bool _failed;
+  bool _ordered;
+};
+
+}
+
+#endif
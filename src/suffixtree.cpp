@@ -30,76 +30,66 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <algorithm>
 #include "suffixtree.h"
 
 using namespace ns_suffixtree;
 using namespace std;
 
-suffixtree::node::node()
-    :begin_i(0),
-     end_i(0),
-     up(0),
-     suffix_link(0),
-     owner(0),
-     number(0) {
-// Constructor initialising an empty node.
-}
-
-suffixtree::node::node(index b,
-                       index e,
-                       node *u,
-                       suffixtree *o,
-                       size_type num)
-    :begin_i(b),
-     end_i(e),
-     up(u),
-     suffix_link(0),
-     owner(o),
-     number(num) {
-// Constructor initialising a node with begin_i, end_i, up, owner and
-// number. suffix_link and children are still empty.
-}
+const suffixtree::node_id suffixtree::none=0xffffffff;
+const suffixtree::node_id suffixtree::root=0;
 
-suffixtree::node::~node() {
-// Destructor automatically calls delete for each of the children
-// recursively.
-  for (map<element_type, node *>::iterator i=children.begin();
-      i!=children.end(); i++) {
-    delete i->second;
-  }
+suffixtree::node_id
+suffixtree::new_node(index b,
+                     index e,
+                     node_id u,
+                     size_type num) {
+// Add a node with begin_i, end_i, up and number to the arena.
+// suffix_link and children are still empty.
+  node n;
+  n.up=u;
+  n.suffix_link=none;
+  n.first_child=none;
+  n.next_sibling=none;
+  n.begin_i=b-sentence.begin();
+  n.end_i=e-sentence.begin();
+  n.number=num;
+  n.key=0;
+  nodes.push_back(n);
+  return nodes.size()-1;
 }
 
-const suffixtree::index
-suffixtree::node::begin() const {
+suffixtree::index
+suffixtree::node_begin(node_id n) const {
 // Return the begin index, stored in begin_i.
-  return begin_i;
+  return sentence.begin()+nodes[n].begin_i;
 }
 
-const suffixtree::size_type
-suffixtree::node::give_number() const {
+suffixtree::size_type
+suffixtree::give_number(node_id n) const {
 // Return the number, stored in number.
-  return number;
+  return nodes[n].number;
 }
 
-const suffixtree::index
-suffixtree::node::end() const {
+suffixtree::index
+suffixtree::node_end(node_id n) const {
 // Return the end index. This is stored in end_i, unless it is a leaf.
-// Then the e value of the owner should be returned, since that
-// denotes the longest handled extension so far.
-  if (children.size()==0) { // no children
-    return owner->e;
+// Then e should be returned, since that denotes the longest handled
+// extension so far.
+  if (nodes[n].first_child==none) { // no children
+    return e;
   }
   else {
-    return end_i;
+    return sentence.begin()+nodes[n].end_i;
   }
 }
 
 void
-suffixtree::node::print_node(ostream &os, size_type depth) const {
+suffixtree::print_node(ostream &os, node_id n, size_type depth) const {
 // Print the content of the node on os. depth indicates how far the
 // current node should be indented.
-  if (begin()!=end()) { // print the entry only if it defines a substring
-    if (children.size()==0) {
+  if (node_begin(n)!=node_end(n)) { // print the entry only if it defines a substring
+    if (nodes[n].first_child==none) {
       os << "+"; // start the line with a + if it is a leaf
     } else {
       os << "-"; // start the line with a - if it has branches
@@ -111,206 +101,241 @@ suffixtree::node::print_node(ostream &os, size_type depth) const {
         d--;
       }
     }
-    os << string(begin(), end()); // print the substring
-    if (children.size()==0) { // if it is a leaf, print it's start index
-      os << number;
+    os << string(node_begin(n), node_end(n)); // print the substring
+    if (nodes[n].first_child==none) { // if it is a leaf, print it's start index
+      os << nodes[n].number;
     }
     os << endl;
   }
-  for (map<element_type, node *>::const_iterator i=children.begin();
-      i!=children.end(); i++) { // print all children
-    i->second->print_node(os, depth+1); // depth+1 it is one level deeper
+  for (node_id c=nodes[n].first_child; c!=none;
+      c=nodes[c].next_sibling) { // print all children
+    print_node(os, c, depth+1); // depth+1 it is one level deeper
   }
 }
 
 suffixtree::position
-suffixtree::node::SEA(index b,
-                      index e,
-                      size_type level,
-                      node*& longest,
-                      index cur,
-                      bool &cont,
-                      bool seek) {
+suffixtree::SEA(node_id n,
+                index b,
+                index e,
+                size_type level,
+                index cur,
+                bool &cont,
+                bool seek) {
 // SEA implements the Single Extension Algorithm (SEA) (see
 // Gusfield). (b, e) is the string to be inserted.  level denotes
-// the start index of the suffix, longest is a pointer to the
-// node containing the current longest suffix. cur points to the
-// end of the current string, and cont is true to start with (to
-// indicate that new extensions should be handled) and set to
-// false if handling new extensions in the current phase is not
-// needed. seek indicates if sv and gamma need to be found (true, yes,
-// false, no).
-  node *sv;
+// the start index of the suffix. cur points to the end of the
+// current string, and cont is true to start with (to indicate that
+// new extensions should be handled) and set to false if handling
+// new extensions in the current phase is not needed. seek indicates
+// if sv and gamma need to be found (true, yes, false, no).
+  node_id sv;
   if (seek) {
-    sv=find_sv(cur, b, e); // find the sv node starting from cur
-    position pos=sv->seek_gamma(b, e-1); // move to the end of gamma from sv
+    sv=find_sv(n, cur, b, e); // find the sv node starting from cur
+    position pos=seek_gamma(sv, b, e-1); // move to the end of gamma from sv
     sv=pos.first;
     cur=pos.second;
   }
   else {
-    sv=this;
+    sv=n;
   }
   // add new character from the end of gamma
-  return sv->extend_gamma(b, e, cur, level, longest, cont);
+  return extend_gamma(sv, b, e, cur, level, cont);
 }
 
 vector<suffixtree::element_type> 
-suffixtree::node::next_children() const {
+suffixtree::next_children(node_id n) const {
 // Collect all possible keys of this node and return them in a vector.
-  map<element_type, node *>::const_iterator i=children.begin();
   vector<element_type> v;
-  while (i!=children.end()) {
-    v.push_back(i->first);
-    i++;
+  for (node_id c=nodes[n].first_child; c!=none; c=nodes[c].next_sibling) {
+    v.push_back(nodes[c].key);
   }
   return v;
 }
 
-const suffixtree::node *
-suffixtree::node::find_child(const element_type &e) const {
-// Find the child that was indexed with e. It returns 0 if the child
-// doesn't exist.
-  map<element_type, node *>::const_iterator f_node=children.find(e);
-  if (f_node==children.end()) {
-    return 0;
+suffixtree::node_id
+suffixtree::find_child(node_id n, const element_type &e) const {
+// Find the child that was indexed with e. It returns none if the
+// child doesn't exist. The children are sorted, so the search stops
+// at the first larger key.
+  node_id c=nodes[n].first_child;
+  while (c!=none && nodes[c].key<e) {
+    c=nodes[c].next_sibling;
+  }
+  if (c!=none && nodes[c].key==e) {
+    return c;
+  }
+  return none;
+}
+
+void
+suffixtree::assign_child(node_id n,
+                         const element_type e,
+                         node_id val) {
+// Set val as a child indexed with value e, replacing the child
+// indexed with e if there is one.
+  node_id *slot=&nodes[n].first_child;
+  while (*slot!=none && nodes[*slot].key<e) {
+    slot=&nodes[*slot].next_sibling;
+  }
+  if (*slot!=none && nodes[*slot].key==e) { // replace
+    nodes[val].next_sibling=nodes[*slot].next_sibling;
+  }
+  else { // insert
+    nodes[val].next_sibling=*slot;
+  }
+  nodes[val].key=e;
+  *slot=val;
+}
+
+void
+suffixtree::find_leaf_positions(node_id n, vector<size_type> &result) const {
+  if (nodes[n].first_child==none) {
+    result.push_back(nodes[n].number);
   }
-  else {
-    return f_node->second;
+  for (node_id c=nodes[n].first_child; c!=none; c=nodes[c].next_sibling) {
+    find_leaf_positions(c, result);
   }
 }
 
-void
-suffixtree::node::assign_child(const element_type e,
-                               node *val) {
-// Set val as a child indexed with value e.
-  children[e]=val;
+suffixtree::size_type
+suffixtree::children_size(node_id n) const {
+  size_type size=0;
+  for (node_id c=nodes[n].first_child; c!=none; c=nodes[c].next_sibling) {
+    size++;
+  }
+  return size;
 }
 
-vector<suffixtree::size_type>
-suffixtree::node::find_leaf_positions() const {
-  vector<size_type> result;
-  if (children.size()==0) {
-    result.push_back(number);
+suffixtree::mask_type
+suffixtree::set_masks(node_id n, const vector<size_type> &groups) {
+// A leaf gets the bit of the last group starting at or before its
+// number, other nodes the union of their children.
+  mask_type mask=0;
+  if (nodes[n].first_child==none) {
+    size_type g=upper_bound(groups.begin(), groups.end(),
+        size_type(nodes[n].number))-groups.begin();
+    if (g>0) {
+      mask=mask_type(1)<<(g-1);
+    }
   }
-  for (map<element_type, node *>::const_iterator c=children.begin();
-      c!=children.end(); c++) {
-    vector<size_type> res=c->second->find_leaf_positions();
-    result.insert(result.end(), res.begin(), res.end());
+  for (node_id c=nodes[n].first_child; c!=none; c=nodes[c].next_sibling) {
+    mask|=set_masks(c, groups);
   }
-  return result;
+  masks[n]=mask;
+  return mask;
 }
 
-const suffixtree::size_type
-suffixtree::node::children_size() const {
-  return children.size();
+suffixtree::mask_type
+suffixtree::give_mask(node_id n) const {
+  return masks.empty()?0:masks[n];
 }
 
-suffixtree::node::node *
-suffixtree::node::find_sv(index cur,
-                          index &b,
-                          index e) {
+suffixtree::node_id
+suffixtree::find_sv(node_id n,
+                    index cur,
+                    index &b,
+                    index e) {
 // find the sv node. This means going back from e towards b matching
 // from cur (cur is the current position, so the string ending with
 // cur should match a suffix of (b, e)). Once a suffix link is found,
 // it is followed. gamma keeps track of the number of positions that
 // have been recognised while going back to find the suffixlink.
 // Note that if no suffixlink is found, b is not changed.
-  node *sv=this; // seeker node going up and through suffixlink
-  size_type gamma=cur-sv->begin(); // current string must be searched
-  sv=sv->up; // going up
-  while (!((sv->up==0)||(sv->suffix_link!=0))) { // find suffix link or root
-    gamma+=sv->end()-sv->begin(); // append gamma
-    sv=sv->up; // going up
-  }
-  if (sv->suffix_link!=0) { // found suffix link
-    sv=sv->suffix_link; // follow suffixlink
+  node_id sv=n; // seeker node going up and through suffixlink
+  size_type gamma=cur-node_begin(sv); // current string must be searched
+  sv=nodes[sv].up; // going up
+  while (!((nodes[sv].up==none)||(nodes[sv].suffix_link!=none))) { // find suffix link or root
+    gamma+=node_end(sv)-node_begin(sv); // append gamma
+    sv=nodes[sv].up; // going up
+  }
+  if (nodes[sv].suffix_link!=none) { // found suffix link
+    sv=nodes[sv].suffix_link; // follow suffixlink
     b=e-gamma; // new begin
   }
   return sv;
 }
 
 suffixtree::position
-suffixtree::node::seek_gamma(index &b,
-                             index e) {
+suffixtree::seek_gamma(node_id n,
+                       index &b,
+                       index e) {
 // seek_gamma follows (b, e) from the end of the current node going
 // up.  New branches are selected, b will be adjusted.  seek_begin
 // will find the index where gamma ends in the tree. The function
-// returns a pointer to the node that contains seek_begin and
-// seek_begin itself. It uses the skip count trick.
-  suffixtree::node *seek_node=this;
-  index seek_begin=seek_node->end();
+// returns the node that contains seek_begin and seek_begin itself.
+// It uses the skip count trick.
+  node_id seek_node=n;
+  index seek_begin=node_end(seek_node);
   size_type g=e-b; // skip count trick
-  size_type g_prime=seek_node->end()-seek_begin;
+  size_type g_prime=node_end(seek_node)-seek_begin;
   while (g_prime<g) {
     g-=g_prime; // skip gamma it must match
     b+=g_prime; // skip b it must match
-    seek_node=seek_node->children[*b]; // choose correct branch
-    seek_begin=seek_node->begin(); // get new seek_begin
-    g_prime=seek_node->end()-seek_node->begin(); // compute new g_prime
+    seek_node=find_child(seek_node, *b); // choose correct branch
+    seek_begin=node_begin(seek_node); // get new seek_begin
+    g_prime=node_end(seek_node)-node_begin(seek_node); // compute new g_prime
   }
   seek_begin+=g; // find end of string(b, e); don't change b
   return make_pair(seek_node, seek_begin);
 }
 
 suffixtree::position
-suffixtree::node::extend_gamma(index b,
-                               index e,
-                               index cur,
-                               size_type level,
-                               node *&longest,
-                               bool &cont) {
+suffixtree::extend_gamma(node_id n,
+                         index b,
+                         index e,
+                         index cur,
+                         size_type level,
+                         bool &cont) {
 // extend_gamma adds the new letter at the end of the gamma. It
 // uses one of the three types of extensions as described in
 // (Gusfield). (b, e) is the new part of the branch, cur is the
 // current position in the branch of the current node. level
 // indicates the starting position in the string of this
-// particular suffix. longest denotes the one past the end
-// iterator of the longest suffix handled sofar. cont is set to
-// false if it is clear that in the current phase, no new
-// suffices need to be added.  (observation 1 and trick 2)
-  node *seek_node=this; // seek_node points to node that gets added to
+// particular suffix. cont is set to false if it is clear that in
+// the current phase, no new suffices need to be added.
+// (observation 1 and trick 2)
+  node_id seek_node=n; // seek_node is the node that gets added to
   element_type new_el=*(e-1); // get last element (e is one past the end)
-  if (cur==end()) {
-    if (children.size()==0) { // rule 1
-      begin_i=b;
-      end_i=e;
-      cur=end_i;
+  if (cur==node_end(n)) {
+    if (nodes[n].first_child==none) { // rule 1
+      nodes[n].begin_i=b-sentence.begin();
+      nodes[n].end_i=e-sentence.begin();
+      cur=e;
     }
     else {
-      map<element_type, node *>::iterator place=children.find(new_el);
-      if (place==children.end()) { // rule 2
-        seek_node=new node(e-1, e, this, owner, level); // new child
-        children[new_el]=seek_node; // add a new child
+      node_id place=find_child(n, new_el);
+      if (place==none) { // rule 2
+        seek_node=new_node(e-1, e, n, level); // new child
+        assign_child(n, new_el, seek_node); // add a new child
         cur=e;
       }
       else { // rule 3
-        seek_node=place->second;
-        cur=seek_node->begin()+1; // first one always matches
+        seek_node=place;
+        cur=node_begin(seek_node)+1; // first one always matches
         cont=false; // rule 3, so don't continue
       }
     }
   } 
-  else { // cur!=end()
+  else { // cur!=node_end(n)
     if (*cur!=new_el) { // rule 2 break string
       // note that the divisions of nodes is very delicate. The
-      // procedure needs to set all pointers correctly, because
+      // procedure needs to set all links correctly, because
       // suffixlinks and return values don't work otherwise.
-      node *break_node=new node(begin(), cur, up, owner,
-          number); // new begin part
-      break_node->up->children[*begin()]=break_node;
-      break_node->children[*cur]=this;
-      break_node->children[new_el]=new node(e-1, e, break_node,
-          owner, level); // new inserted part
-      up=break_node; // adjust up to new (break) node
-      begin_i=cur; // this becomes end part
-      seek_node=break_node->children[new_el];
-      cur=seek_node->end();
-      if (owner->sw!=0) { // handle sw if present before we store new one
-        owner->sw->suffix_link=break_node; // break node is new begin part
-        owner->sw=0;
+      node_id break_node=new_node(node_begin(n), cur, nodes[n].up,
+          nodes[n].number); // new begin part
+      assign_child(nodes[n].up, *node_begin(n), break_node);
+      assign_child(break_node, *cur, n);
+      seek_node=new_node(e-1, e, break_node, level); // new inserted part
+      assign_child(break_node, new_el, seek_node);
+      nodes[n].up=break_node; // adjust up to new (break) node
+      nodes[n].begin_i=cur-sentence.begin(); // this becomes end part
+      cur=node_end(seek_node);
+      if (sw!=none) { // handle sw if present before we store new one
+        nodes[sw].suffix_link=break_node; // break node is new begin part
+        sw=none;
       }
-      if(up!=0) { // skip root
-        owner->sw=break_node;
+      if (nodes[n].up!=none) { // skip root
+        sw=break_node;
       }
       return make_pair(seek_node, cur);
     }
@@ -319,21 +344,19 @@ suffixtree::node::extend_gamma(index b,
       cont=false; // rule 3, so don't continue
     }
   }
-  if (owner->sw!=0) { // store sw's suffix link
-    owner->sw->suffix_link=this;
-    owner->sw=0;
+  if (sw!=none) { // store sw's suffix link
+    nodes[sw].suffix_link=n;
+    sw=none;
   }
   return make_pair(seek_node, cur);
 }
 
 suffixtree::suffixtree(value_type s)
-    :root(sentence.begin(), sentence.end(), 0, this, 0),
-     j_i(0),
+    :j_i(0),
      init_current(false),
      rule3stopped(false),
-     sw(0) {
+     sw(none) {
 // suffix tree constructor. s is the sentence.
-  longest=&root; // setup longest (which is the entire sentence at the moment
   add_sentence(s); // actually build the suffix tree
 }
 
@@ -341,72 +364,73 @@ suffixtree::size_type
 suffixtree::find_position(value_type w) const {
 // Check if sentence is a substring in the suffix tree. Throw a
 // StringNotFound if it is not.
+  node_id current=find_node(w);
+  if (current==none) {
+    throw StringNotFound();
+  }
+  return nodes[current].number;
+}
+
+suffixtree::node_id
+suffixtree::find_node(const value_type &w) const {
+// Follow w from the root and return the node in which it ends.
   suffixtree::index i=w.begin(); // search index in w
-  const node *current=&root; // start at the root
+  node_id current=root; // start at the root
   if (i==w.end()) { // empty strings are not found
-    throw StringNotFound();
+    return none;
   }
-  if (current->begin()==current->end()) { // empty substring
-    current=current->find_child(*i); // find next branch
-    if (current==0) { // couldn't find next branch
-      throw StringNotFound();
+  if (node_begin(current)==node_end(current)) { // empty substring
+    current=find_child(current, *i); // find next branch
+    if (current==none) { // couldn't find next branch
+      return none;
     }
   }
-  suffixtree::index seeker=current->begin(); // begin of substring
+  suffixtree::index seeker=node_begin(current); // begin of substring
+  suffixtree::index end=node_end(current);
   while (*i==*seeker) {
     i++;
     if (i==w.end()) {
       break;
     }
     seeker++;
-    if (seeker==current->end()) { // branch
-      current=current->find_child(*i); // next branch
-      if (current==0) { // couldn't find right branch
-        throw StringNotFound(); // and string is not finished yet
+    if (seeker==end) { // branch
+      current=find_child(current, *i); // next branch
+      if (current==none) { // couldn't find right branch
+        return none; // and string is not finished yet
       }
-      seeker=current->begin(); // adjust seeker pointer
+      seeker=node_begin(current); // adjust seeker pointer
+      end=node_end(current);
     }
   }
   if (i==w.end()) { // found position
-    return current->give_number();
+    return current;
   }
-  throw StringNotFound(); // should never be reached
+  return none;
 }
 
 vector<suffixtree::size_type>
 suffixtree::find_all_positions(value_type w) const {
-  suffixtree::index i=w.begin(); // search index in w
   vector<size_type> results;
-  const node *current=&root; // start at the root
-  if (i==w.end()) { // empty strings are not found
-    return results;
-  }
-  if (current->begin()==current->end()) { // empty substring
-    current=current->find_child(*i); // find next branch
-    if (current==0) { // couldn't find next branch
-      return results;
-    }
-  }
-  suffixtree::index seeker=current->begin(); // begin of substring
-  while (*i==*seeker) {
-    i++;
-    if (i==w.end()) {
-      break;
-    }
-    seeker++;
-    if (seeker==current->end()) { // branch
-      current=current->find_child(*i); // next branch
-      if (current==0) { // couldn't find right branch
-        return results; // and string is not finished yet
-      }
-      seeker=current->begin(); // adjust seeker pointer
-    }
+  node_id current=find_node(w);
+  if (current!=none) { // found position
+    find_leaf_positions(current, results);
   }
-  if (i==w.end()) { // found position
-    vector<size_type> subres=current->find_leaf_positions();
-    results.insert(results.end(), subres.begin(), subres.end());
+  return results;
+}
+
+void
+suffixtree::set_masks(const vector<size_type> &groups) {
+  masks.assign(nodes.size(), 0);
+  set_masks(root, groups);
+}
+
+suffixtree::mask_type
+suffixtree::find_mask(const value_type &w) const {
+  node_id current=find_node(w);
+  if (current==none) {
+    return 0;
   }
-  return results; // should never be reached
+  return give_mask(current);
 }
 
 bool
@@ -441,20 +465,25 @@ void
 suffixtree::print(ostream &os) const {
 // print the suffixtree on os. Start with the root node.
   os << "root" << endl;
-  root.print_node(os, 0); // level is 0, it is the root node
+  print_node(os, root, 0); // level is 0, it is the root node
 }
 
 void
 suffixtree::add_sentence(value_type s) {
 // Build the suffix tree based on s.
   sentence=s; // remember sentence
+  nodes.clear();
+  nodes.reserve(2*sentence.size()+1); // the most nodes a tree can have
+  new_node(sentence.begin(), sentence.begin(), none, 0); // the root
+  longest=root;
+  e=sentence.begin();
   if (sentence.begin()==sentence.end()) { // no sentence
     return; // nothing to do
   }
   // build I_0
-  node *first=new node(sentence.begin(), sentence.begin()+1, &root,
-      this, 0); // extension starts at index 0
-  root.assign_child(*sentence.begin(), first); // first char is a child of root
+  node_id first=new_node(sentence.begin(), sentence.begin()+1, root,
+      0); // extension starts at index 0
+  assign_child(root, *sentence.begin(), first); // first char is a child of root
   e=sentence.begin()+1; // next char to do
   longest=first; // we have a longest substring
   suffixtree::index m=sentence.end();
@@ -471,13 +500,13 @@ suffixtree::SPA(suffixtree::index i) {
   e=i; //special case longest string, increase e
   size_type j_index=j_i+1;
   if (!init_current) {
-    current=make_pair(longest, longest->end());
+    current=make_pair(longest, node_end(longest));
     init_current=true;
   }
   bool cont=true;
   if (rule3stopped) {// we already know where to extend
-    current=current.first->SEA(i-1, i, j_index, longest,
-        current.second, cont, false);
+    current=SEA(current.first, i-1, i, j_index, current.second, cont,
+        false);
     j_index++;
     rule3stopped=false;
     if (!cont) {
@@ -486,8 +515,7 @@ suffixtree::SPA(suffixtree::index i) {
     }
   }
   for (suffixtree::index j=sentence.begin()+j_index; j<i; j++) {
-    current=current.first->SEA(j, i, j_index, longest,
-        current.second, cont, true);
+    current=SEA(current.first, j, i, j_index, current.second, cont, true);
     if (!cont) { // no need to continue (step 3 has been done)
       rule3stopped=true; // remember that rule 3 stopped us
       break;
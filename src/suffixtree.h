@@ -10,9 +10,9 @@
 ////////////////////////////////////////////////////////////////////////////////
 // This file contains the implementation of the classes used in the
 // suffix tree package. The class suffixtree contains the
-// functionality of a suffix tree, while the class node is only used
-// by the suffixtree class. Both classes are defined in the
-// ns_suffixtree namespace.
+// functionality of a suffix tree, while the struct node is only used
+// by the suffixtree class. Both are defined in the ns_suffixtree
+// namespace.
 //////////////////////////////////////////////////////////////////////////////*/
 // Copyright (C) 2008  Diego Molla-Aliod <diego@ics.mq.edu.au>
 //
@@ -34,11 +34,10 @@
 #define __suffixtree__
 
 #include <iostream>
-#include <map>
 #include <string>
 #include <vector>
+#include <stdint.h>
 
-using std::map;
 using std::ostream;
 using std::pair;
 using std::string;
@@ -57,168 +56,51 @@ public:
   typedef value_type::size_type size_type;
   typedef value_type::value_type element_type;
   typedef value_type::const_iterator index;
+  typedef uint64_t mask_type;
 
 protected:
-  class node; // forward reference
-
-  typedef pair<node *, index> position;
-
-  class node {
-  // node is a support class for the suffixtree class. Each
-  // instance of node describes a part of the actual suffix tree. 
-  // Actually, node describes the (sub)string that is between two
-  // nodes. The node's suffixlink is attached to the node before
-  // the begin of the (sub)string.
-  public:
-    // node creates an empty node
-    node();
-
-    // node creates a node with substring (b, e). u denotes the node
-    // one level up, o is the owner of the node (the suffixtree
-    // instance that it belongs to) and num is the offset in the
-    // string where the suffix starts.
-    node(index b,
-         index e,
-         node *u,
-         suffixtree *o,
-         size_type num);
-
-    // ~node destructor.
-    ~node();
-  
-    // begin returns the index denoting the begin of the (sub)string
-    // in the node.
-    const index
-    begin() const;
-
-    // end returns the index denoting the end of the (sub)string
-    // in the node. (end actually returns the one past the end
-    // pointer.)
-    const index
-    end() const;
-
-    // give_number returns the number stored in the node.
-    const size_type
-    give_number() const;
-
-    // print_node writes the contents of the node on os in a
-    // pleasing format. depth indicates how deep the node is
-    // expected to be in the tree. This is used to print offsets
-    // denoting tree depth.
-    void
-    print_node(ostream &os, size_type depth) const;
-
-    // SEA implements the Single Extension Algorithm (SEA) (see
-    // Gusfield). (b, e) is the string to be inserted. level denotes
-    // the start index of the suffix, longest is a pointer to the
-    // node containing the current longest suffix. cur points to the
-    // end of the current string, and cont is true to start with (to
-    // indicate that new extensions should be handled) and set to
-    // false if handling new extensions in the current phase is not
-    // needed. seek indicates if sv and gamma need to be found.
-    position
-    SEA(index b,
-        index e,
-        size_type level,
-        node *&longest,
-        index cur,
-        bool &cont,
-        bool seek);
-
-    // find_child finds the child node whose string begins with e.
-    // A pointer to that node is returned. It returns 0 if the child
-    // doesn't exist.
-    vector<element_type>
-    next_children() const;
-
-    // find_child finds the child node whose string begins with e.
-    // A pointer to that node is returned. It returns 0 if the child
-    // doesn't exist.
-    const node *
-    find_child(const element_type &e) const;
-
-    // assign_child sets val as a child of this node indexed with
-    // value e. It is expected that e is the first value of the
-    // string contained in val.
-    void
-    assign_child(const element_type e,
-                 node *val);
-
-    // find_leaf_positions finds all leaves reachable from this. It
-    // returns all numbers that are found in these leaves. The
-    // vector is unordered.
-    vector<size_type>
-    find_leaf_positions() const;
-
-    // children_size returns the number of direct children at this
-    // node.
-    const size_type
-    children_size() const;
-
-  protected:
-  private:
-    // find_sv finds the sv node starting from cur. Once the v node
-    // is found, the suffix_link is followed and b is adjusted. It
-    // finds the new gamma (b, e) with b adjusted if needed. A
-    // pointer to the sv node is returned.
-    node *
-    find_sv(index cur,
-            index &b,
-            index e);
-
-    // seek_gamma follows (b, e) from the end of the current node.
-    // New branches are selected, b will be adjusted. seek_begin
-    // will find the index where gamma ends in the tree. The
-    // function returns a position containing a pointer to a node
-    // and an index indicating where gamma ends.
-    position
-    seek_gamma(index &b,
-               index e);
-
-    // extend_gamma adds the new letter at the end of the gamma. It
-    // uses one of the three types of extensions as described in
-    // (Gusfield). (b, e) is the new part of the branch, cur is the
-    // current position in the branch of the current node. level
-    // indicates the starting position in the string of this
-    // particular suffix. longest denotes the one past the end
-    // iterator of the longest suffix handled sofar. cont is set to
-    // false if it is clear that in the current phase, no new
-    // suffices need to be added. (observation 1 and trick 2)
-    position
-    extend_gamma(index b,
-                 index e,
-                 index cur,
-                 size_type level,
-                 node *&longest,
-                 bool &cont);
-  
-    // children relates the children of the node by their first
-    // element of the string.
-    map<element_type, node *> children;
-
-    // begin_i points to the begin of the substring of the current
-    // node.
-    index begin_i;
-
-    // end_i points to the one past the end of the substring of the
-    // current node.
-    index end_i;
-  
-    // up points to the node one level up. If it is the root node,
-    // it points to 0.
-    node *up;
-
-    // suffix_link points to another node in the tree. It's
-    // semantics is that of a suffix_link (see (Gusfield)).
-    node *suffix_link;
-
-    // owner points to a suffixtree class that has this node as
-    // a part of the actual tree.
-    suffixtree *owner;
+  // node_id is the number of a node in the arena of the tree. 32 bit
+  // numbers and offsets limit the sentence to 2^32-2 elements.
+  typedef uint32_t node_id;
+
+  typedef pair<node_id, index> position;
+
+  // none denotes a missing node; root is the number of the root node.
+  static const node_id none;
+  static const node_id root;
+
+  struct node {
+  // node describes a part of the actual suffix tree. Actually, node
+  // describes the (sub)string that is between two nodes. The node's
+  // suffixlink is attached to the node before the begin of the
+  // (sub)string. All nodes of a tree are kept in one arena and
+  // refer to each other by number.
+
+    // up is the node one level up. If it is the root node, it is
+    // none.
+    node_id up;
+
+    // suffix_link is another node in the tree. It's semantics is
+    // that of a suffix_link (see (Gusfield)).
+    node_id suffix_link;
+
+    // first_child is the first of the children of the node and
+    // next_sibling the next child of the same parent. The children
+    // of a node are kept sorted by key.
+    node_id first_child;
+    node_id next_sibling;
+
+    // begin_i and end_i are the offsets in the sentence of the begin
+    // and one past the end of the substring of the node.
+    uint32_t begin_i;
+    uint32_t end_i;
 
     // number is the offset in the string indicating where the
     // suffix has started.
-    size_type number;
+    uint32_t number;
+
+    // key is the element the node is indexed with by its parent.
+    element_type key;
   };
 
 public:
@@ -236,6 +118,19 @@ public:
   vector<size_type>
   find_all_positions(value_type w) const;
 
+  // set_masks splits the sentence into consecutive groups, group g
+  // starting at offset groups[g], and records in every node which
+  // groups the positions of the leaves below it fall in. At most 64
+  // groups can be used.
+  void
+  set_masks(const vector<size_type> &groups);
+
+  // find_mask returns the groups (bit g set for group g) of all
+  // positions that find_all_positions would return for w, in time
+  // linear in the length of w. set_masks must have been called.
+  mask_type
+  find_mask(const value_type &w) const;
+
   // self_test returns true if all affixes of w can be found in the
   // suffixtree and it returns false if it doesn't. It dumps some
   // debug information on cerr.
@@ -247,6 +142,131 @@ public:
   print(ostream &os) const;
 
 protected:
+  // new_node adds a node with substring (b, e) to the arena. u
+  // denotes the node one level up and num is the offset in the
+  // string where the suffix starts.
+  node_id
+  new_node(index b,
+           index e,
+           node_id u,
+           size_type num);
+
+  // node_begin returns the index denoting the begin of the
+  // (sub)string in node n.
+  index
+  node_begin(node_id n) const;
+
+  // node_end returns the index denoting the end of the (sub)string
+  // in node n. (node_end actually returns the one past the end
+  // pointer.)
+  index
+  node_end(node_id n) const;
+
+  // give_number returns the number stored in node n.
+  size_type
+  give_number(node_id n) const;
+
+  // print_node writes the contents of node n on os in a pleasing
+  // format. depth indicates how deep the node is expected to be in
+  // the tree. This is used to print offsets denoting tree depth.
+  void
+  print_node(ostream &os, node_id n, size_type depth) const;
+
+  // SEA implements the Single Extension Algorithm (SEA) (see
+  // Gusfield) from node n. (b, e) is the string to be inserted.
+  // level denotes the start index of the suffix. cur points to the
+  // end of the current string, and cont is true to start with (to
+  // indicate that new extensions should be handled) and set to
+  // false if handling new extensions in the current phase is not
+  // needed. seek indicates if sv and gamma need to be found.
+  position
+  SEA(node_id n,
+      index b,
+      index e,
+      size_type level,
+      index cur,
+      bool &cont,
+      bool seek);
+
+  // next_children returns the keys of the children of node n.
+  vector<element_type>
+  next_children(node_id n) const;
+
+  // find_child finds the child node of n whose string begins with
+  // e. It returns none if the child doesn't exist.
+  node_id
+  find_child(node_id n, const element_type &e) const;
+
+  // assign_child sets val as a child of node n indexed with value
+  // e, in place of the child indexed with e if there is one. It is
+  // expected that e is the first value of the string contained in
+  // val.
+  void
+  assign_child(node_id n,
+               const element_type e,
+               node_id val);
+
+  // find_leaf_positions adds to result the numbers of all leaves
+  // reachable from node n. The vector is unordered.
+  void
+  find_leaf_positions(node_id n, vector<size_type> &result) const;
+
+  // children_size returns the number of direct children of node n.
+  size_type
+  children_size(node_id n) const;
+
+  // set_masks sets the mask of each leaf reachable from node n to
+  // the bit of the group its number falls in (see set_masks above)
+  // and the mask of each node to the union of the masks of its
+  // children. It returns the mask of n.
+  mask_type
+  set_masks(node_id n, const vector<size_type> &groups);
+
+  // give_mask returns the mask of node n.
+  mask_type
+  give_mask(node_id n) const;
+
+  // find_sv finds the sv node starting from cur in node n. Once the
+  // v node is found, the suffix_link is followed and b is adjusted.
+  // It finds the new gamma (b, e) with b adjusted if needed. The sv
+  // node is returned.
+  node_id
+  find_sv(node_id n,
+          index cur,
+          index &b,
+          index e);
+
+  // seek_gamma follows (b, e) from the end of node n. New branches
+  // are selected, b will be adjusted. seek_begin will find the
+  // index where gamma ends in the tree. The function returns a
+  // position containing a node and an index indicating where gamma
+  // ends.
+  position
+  seek_gamma(node_id n,
+             index &b,
+             index e);
+
+  // extend_gamma adds the new letter at the end of the gamma in
+  // node n. It uses one of the three types of extensions as
+  // described in (Gusfield). (b, e) is the new part of the branch,
+  // cur is the current position in the branch of the current node.
+  // level indicates the starting position in the string of this
+  // particular suffix. cont is set to false if it is clear that in
+  // the current phase, no new suffices need to be added.
+  // (observation 1 and trick 2)
+  position
+  extend_gamma(node_id n,
+               index b,
+               index e,
+               index cur,
+               size_type level,
+               bool &cont);
+
+  // find_node returns the node in which w ends, or none if w is not
+  // a substring of the sentence.
+  node_id
+  find_node(const value_type &w) const;
+
   // add_sentence actually builds the suffixtree based on s.
   void
   add_sentence(value_type s);
@@ -259,17 +279,25 @@ protected:
   // sentence contains the sentence contained in the suffixtree
   value_type sentence;
 
-  // root is the root node of the suffix tree
-  node root;
+  // nodes is the arena holding all nodes of the tree, the root
+  // first. A tree of a sentence of n elements has at most 2n nodes.
+  vector<node> nodes;
+
+  // masks holds the mask of each node once set_masks is called.
+  vector<mask_type> masks;
 
-  // longest is a pointer to the node containing the longest suffix
-  node *longest;
+  // longest is the node containing the longest suffix
+  node_id longest;
 
   // e indexes into sentence denoting the longest extension handled
   // so far. It shifts one character further each phase.
   index e;
 
 private:
+  // a suffixtree refers into its own sentence, so it is not copied
+  suffixtree(const suffixtree &other);
+  suffixtree &operator=(const suffixtree &other);
+
   // static variables that need to be stored in a tree (to allow for
   // multiple suffixtrees).
 
@@ -287,7 +315,7 @@ private:
   bool rule3stopped;
 
   // sw will be used as a suffix link 
-  node *sw;
+  node_id sw;
 };
 
 // operator<< writes t on os using the print function of the
@@ -28,10 +28,12 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <algorithm>
 #include "tokenDeco.h"
 #include "ner.h"
 #include <sstream>
 #include <iostream>
+#include <boost/thread/mutex.hpp>
 
 using namespace std;
 using namespace AF;
@@ -39,17 +41,92 @@ using namespace AF;
 const int CLASSCOUNT=13;
 
 ////////////////////////////////////////////////////////////////////////////////
-// Constructor: initialises the token pointer.
+// The slots of the names seen so far.  Names may be seen by several threads.
 ////////////////////////////////////////////////////////////////////////////////
-TokenDeco::TokenDeco(const Token* t):Token(*t),_component(t){
+struct InfoSlots {
+  map<StringXML,int> slots;
+  boost::mutex lock;
+};
+
+static InfoSlots&
+infoSlots() {
+  static InfoSlots slots;
+  return slots;
+}
+
+int
+InfoRegistry::slot(const StringXML& name) {
+  InfoSlots& s=infoSlots();
+  boost::mutex::scoped_lock lock(s.lock);
+  map<StringXML,int>::const_iterator i=s.slots.find(name);
+  if (i!=s.slots.end()) {
+    return i->second;
+  }
+  const int slot=s.slots.size();
+  s.slots[name]=slot;
+  return slot;
+}
+
+int
+InfoRegistry::slot(const StringXML& prefix,const int number) {
+  stringstream ss;
+  ss << prefix << number;
+  return slot(ss.str());
+}
+
+size_t
+InfoRegistry::size() {
+  InfoSlots& s=infoSlots();
+  boost::mutex::scoped_lock lock(s.lock);
+  return s.slots.size();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// Returns a pointer to the token
+// Constructor: a document without tokens
 ////////////////////////////////////////////////////////////////////////////////
-const Token* 
-TokenDeco::getComponent() const{
-  return _component;
+TokenDocument::TokenDocument():_tokens(0),_words(0),_slots(0){
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 'reset' clears the information of the document and makes it 'tokens'
+// tokens long.  Room is made for every slot given so far, and 'assign' keeps
+// the memory of the arrays.
+////////////////////////////////////////////////////////////////////////////////
+void
+TokenDocument::reset(const size_t tokens){
+  _tokens = tokens;
+  _words = (tokens+63)/64;
+  _slots = InfoRegistry::size();
+  _values.assign(_slots*_tokens,0.0);
+  _present.assign(_slots*_words,0);
+}
+
+size_t
+TokenDocument::size() const{
+  return _tokens;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 'grow' adds the columns of 'slot', and of every slot given so far, so that
+// a document grows once as a rule.  The columns there are stay in place.
+////////////////////////////////////////////////////////////////////////////////
+void
+TokenDocument::grow(const int slot){
+  _slots = max(static_cast<size_t>(slot)+1,InfoRegistry::size());
+  _values.resize(_slots*_tokens,0.0);
+  _present.resize(_slots*_words,0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor: the token 't' of 'document', at 'index'
+////////////////////////////////////////////////////////////////////////////////
+TokenDeco::TokenDeco(const Token& t, TokenDocument* document,
+    const size_t index):Token(t),_document(document),_index(index){
+}
+
+void
+TokenDeco::setDocument(TokenDocument* document){
+  _document = document;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -57,7 +134,7 @@ TokenDeco::getComponent() const{
 ////////////////////////////////////////////////////////////////////////////////
 void
 TokenDeco::setInfo(const StringXML name, const double value){
-   _info[name] = value;
+   setInfo(InfoRegistry::slot(name),value);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -67,21 +144,17 @@ TokenDeco::setInfo(const StringXML name, const double value){
 ////////////////////////////////////////////////////////////////////////////////
 bool
 TokenDeco::getInfo(const StringXML& name, double& value) const{
-  bool res = false;
-  map<StringXML,double>::const_iterator pos = _info.find(name);
-  if (pos!=_info.end()){
-    value = pos->second;
-    res = true;
-  }
-  return res;
+  return getInfo(InfoRegistry::slot(name),value);
 }
 
 vector<TokenDeco>
-AF::convertTokens(const vector<Token>& tokens){
+AF::convertTokens(const vector<Token>& tokens, TokenDocument& document){
+  document.reset(tokens.size());
   vector<TokenDeco> res;
+  res.reserve(tokens.size());
   for (vector<Token>::const_iterator ite=tokens.begin();
       ite!=tokens.end();ite++){
-    res.push_back(TokenDeco(&(*ite)));
+    res.push_back(TokenDeco(*ite,&document,ite-tokens.begin()));
   }
   return res;
 }
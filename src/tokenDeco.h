@@ -31,6 +31,7 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <stdint.h>
 #include "tokeniser.h"
 #include "xml_string.h"
 
@@ -41,20 +42,110 @@ using namespace AF;
 namespace AF {
 
 ////////////////////////////////////////////////////////////////////////////////
-// 'Token' denotes a word in the text.
+// 'InfoRegistry' numbers the names of the information stored in tokens, from
+// 0 in the order they are first seen, so that a token stores its information
+// in an array indexed by these slots.  The feature extractors look up the
+// slots of their names once, when they are built.
+////////////////////////////////////////////////////////////////////////////////
+class InfoRegistry {
+public:
+////////////////////////////////////////////////////////////////////////////////
+// 'slot(name)' returns the slot of a name, giving it one if it has none.
+// 'slot(prefix,number)' does so for the name made of both, e.g. "prob3".
+////////////////////////////////////////////////////////////////////////////////
+  static int
+  slot(const StringXML& name);
+
+  static int
+  slot(const StringXML& prefix,const int number);
+
+////////////////////////////////////////////////////////////////////////////////
+// 'size()' returns the number of slots given so far
+////////////////////////////////////////////////////////////////////////////////
+  static size_t
+  size();
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// 'TokenDocument' stores the information of all the tokens of a document in
+// contiguous arrays, a column per slot of the InfoRegistry: the values of a
+// slot for every token, and a bitset of the tokens that have it set.  The
+// marks of a list or regex are thus one bitset over the document, and
+// reading a slot across tokens reads contiguous memory.  New slots add
+// columns at the end, and the arrays are kept from document to document, so
+// that no memory is allocated once they are large enough.
+////////////////////////////////////////////////////////////////////////////////
+class TokenDocument {
+public:
+////////////////////////////////////////////////////////////////////////////////
+// Constructor: a document without tokens
+////////////////////////////////////////////////////////////////////////////////
+  TokenDocument();
+
+////////////////////////////////////////////////////////////////////////////////
+// 'reset' clears the information of the document and makes it 'tokens'
+// tokens long
+////////////////////////////////////////////////////////////////////////////////
+  void
+  reset(const size_t tokens);
+
+////////////////////////////////////////////////////////////////////////////////
+// 'size' returns the number of tokens
+////////////////////////////////////////////////////////////////////////////////
+  size_t
+  size() const;
+
+////////////////////////////////////////////////////////////////////////////////
+// 'setInfo' and 'getInfo' set and get the information in 'slot' of token
+// number 'token'.  getInfo returns false if it has not been set.
+////////////////////////////////////////////////////////////////////////////////
+  void
+  setInfo(const int slot, const size_t token, const double value) {
+    if (static_cast<size_t>(slot)>=_slots) {
+      grow(slot);
+    }
+    _values[slot*_tokens+token] = value;
+    _present[slot*_words+(token>>6)] |= uint64_t(1)<<(token&63);
+  }
+
+  bool
+  getInfo(const int slot, const size_t token, double& value) const {
+    if (static_cast<size_t>(slot)>=_slots ||
+        !(_present[slot*_words+(token>>6)]&(uint64_t(1)<<(token&63)))) {
+      return false;
+    }
+    value = _values[slot*_tokens+token];
+    return true;
+  }
+
+private:
+  void
+  grow(const int slot);
+
+  size_t _tokens;
+  size_t _words;     // the 64 bit words of a bitset over the tokens
+  size_t _slots;
+  vector<double> _values;
+  vector<uint64_t> _present;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// 'Token' denotes a word in the text.  Its information is stored in token
+// number 'index' of a TokenDocument.
 ////////////////////////////////////////////////////////////////////////////////
 class TokenDeco : public Token {
 public:
 ////////////////////////////////////////////////////////////////////////////////
-// Constructor: initialises the token pointer
+// Constructor: the token 't' of 'document', at 'index'
 ////////////////////////////////////////////////////////////////////////////////
-  TokenDeco(const Token* t);
+  TokenDeco(const Token& t, TokenDocument* document, const size_t index);
 
 ////////////////////////////////////////////////////////////////////////////////
-// Returns a pointer to the token
+// 'setDocument' moves the token to the same index of another document, e.g.
+// a copy of its document
 ////////////////////////////////////////////////////////////////////////////////
-  const Token* 
-  getComponent() const;
+  void
+  setDocument(TokenDocument* document);
 
 ////////////////////////////////////////////////////////////////////////////////
 // 'setInfo(name,value)' sets extra information about a token, name and value.
@@ -70,17 +161,31 @@ public:
   bool
   getInfo(const StringXML& name, double& value) const;
 
-private:
-  const Token* _component;
 ////////////////////////////////////////////////////////////////////////////////
-// '_info' stores extra information about the token.  The relationship is
-// is similar to a feature name/value relationship.
+// 'setInfo(slot,value)' and 'getInfo(slot,value)' do the same for the name
+// with that slot in the InfoRegistry, without looking the name up.
 ////////////////////////////////////////////////////////////////////////////////
-  map<StringXML,double> _info;
+  void
+  setInfo(const int slot, const double value) {
+    _document->setInfo(slot,_index,value);
+  }
+
+  bool
+  getInfo(const int slot, double& value) const {
+    return _document->getInfo(slot,_index,value);
+  }
+
+private:
+  TokenDocument* _document;
+  size_t _index;
 };
 
+////////////////////////////////////////////////////////////////////////////////
+// 'convertTokens' resets 'document' to the tokens given, and returns them
+// decorated with the document
+////////////////////////////////////////////////////////////////////////////////
 vector<TokenDeco>
-convertTokens(const vector<Token>& tokens);
+convertTokens(const vector<Token>& tokens, TokenDocument& document);
 
 }
 
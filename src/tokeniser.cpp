@@ -77,6 +77,7 @@
 
 #include <iostream>
 #include <vector>
+#include <cctype>
 #include "tokeniser.h"
 
 using namespace std;
@@ -91,7 +92,7 @@ using boost::regex_search;
 ////////////////////////////////////////////////////////////////////////////////
 Token::Token(StringXML::size_type begin,
       StringXML::size_type end)
-      :_begin(begin),_end(end) {
+      :_begin(begin),_end(end),_shape(0) {
 }
 
 
@@ -162,6 +163,94 @@ Token::getString(const StringXML& original) const {
 }
 
 
+////////////////////////////////////////////////////////////////////////////////
+// 'getView()' returns the string the token points to, in place.
+////////////////////////////////////////////////////////////////////////////////
+TokenView
+Token::getView(const StringXML& original) const {
+  return TokenView(original.data()+_begin,_end-_begin);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// 'getLength()' returns the number of characters of the token.
+////////////////////////////////////////////////////////////////////////////////
+StringXML::size_type
+Token::getLength() const {
+  return _end-_begin;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// 'setShape()' and 'getShape()' set and return the TokenShape bits.
+////////////////////////////////////////////////////////////////////////////////
+void
+Token::setShape(const unsigned int shape) {
+  _shape=shape;
+}
+
+unsigned int
+Token::getShape() const {
+  return _shape;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// 'CharShapes' classifies each character once, as isupper, islower and
+// isdigit do, so that the shape of a token costs a table look up per
+// character.
+////////////////////////////////////////////////////////////////////////////////
+enum CharShape {
+  CHAR_UPPER=1,
+  CHAR_LOWER=2,
+  CHAR_DIGIT=4
+};
+
+struct CharShapes {
+  unsigned char shape[256];
+  CharShapes() {
+    for (int c=0;c<256;c++) {
+      shape[c]=(isupper(c) ? CHAR_UPPER : 0)|(islower(c) ? CHAR_LOWER : 0)|
+          (isdigit(c) ? CHAR_DIGIT : 0);
+    }
+  }
+};
+
+static const CharShapes charShapes;
+
+////////////////////////////////////////////////////////////////////////////////
+// 'tokenShape' returns the TokenShape bits of the characters from begin to
+// end.
+////////////////////////////////////////////////////////////////////////////////
+static unsigned int
+tokenShape(const StringXML::const_iterator begin,
+    const StringXML::const_iterator end) {
+  unsigned int shape=SHAPE_ALL_DIGITS;
+  if (begin!=end && charShapes.shape[static_cast<unsigned char>(*begin)]&CHAR_UPPER) {
+    shape|=SHAPE_INIT_CAP;
+  }
+  for (StringXML::const_iterator i=begin;i!=end;++i) {
+    const unsigned char c=charShapes.shape[static_cast<unsigned char>(*i)];
+    shape|=(c&CHAR_LOWER) ? SHAPE_LOWER : SHAPE_NOT_LOWER;
+    if (c&CHAR_DIGIT) {
+      shape|=SHAPE_DIGIT;
+    }
+    else {
+      shape&=~SHAPE_ALL_DIGITS;
+    }
+  }
+  if (end-begin==1) {
+    if ((*begin=='.')||(*begin=='!')||(*begin=='?')) {
+      shape|=SHAPE_SENT_END;
+    }
+    if (*begin=='.') {
+      shape|=SHAPE_PERIOD;
+    }
+  }
+  return shape;
+}
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // 'skipWhitespace' skips any whitespace starting from begin.  It returns an
 // iterator to the first non-whitespace character.
@@ -240,6 +329,7 @@ AF::getToken(const StringXML::const_iterator begin,
   if (foundToken) {
     token.setBegin(tokenBegin-begin+offset);
     token.setEnd(tokenEnd-begin+offset);
+    token.setShape(tokenShape(tokenBegin,tokenEnd));
   }
   return foundToken;
 }
@@ -69,6 +69,8 @@
 
 #include <vector>
 #include <string>
+#include <cstring>
+#include <stdexcept>
 #include "xml_string.h"
 
 using namespace std;
@@ -108,6 +110,78 @@ public:
   }
 };
 
+////////////////////////////////////////////////////////////////////////////////
+// 'TokenView' is the string of a token read in place, in the text the token
+// comes from, rather than copied.  It is only valid while that text is not
+// changed.
+////////////////////////////////////////////////////////////////////////////////
+class TokenView {
+public:
+  TokenView(const char* begin=0,const StringXML::size_type size=0)
+      :_begin(begin),_size(size) {
+  }
+
+  const char*
+  begin() const {
+    return _begin;
+  }
+
+  const char*
+  end() const {
+    return _begin+_size;
+  }
+
+  StringXML::size_type
+  length() const {
+    return _size;
+  }
+
+  char
+  operator[](const StringXML::size_type i) const {
+    return _begin[i];
+  }
+
+////////////////////////////////////////////////////////////////////////////////
+// 'at()' checks the position, and throws out_of_range, as StringXML::at does
+////////////////////////////////////////////////////////////////////////////////
+  char
+  at(const StringXML::size_type i) const {
+    if (i>=_size) {
+      throw out_of_range("TokenView::at");
+    }
+    return _begin[i];
+  }
+
+  bool
+  operator==(const char* s) const {
+    return strlen(s)==_size && memcmp(_begin,s,_size)==0;
+  }
+
+  StringXML
+  str() const {
+    return StringXML(_begin,_size);
+  }
+
+private:
+  const char* _begin;
+  StringXML::size_type _size;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// 'TokenShape' are the orthographic properties of a token, found by
+// 'getToken' as it reads the token, so that the feature extractors read them
+// rather than the characters of the token.
+////////////////////////////////////////////////////////////////////////////////
+enum TokenShape {
+  SHAPE_INIT_CAP=1,     // the first character is upper case
+  SHAPE_LOWER=2,        // some character is lower case
+  SHAPE_NOT_LOWER=4,    // some character is not lower case
+  SHAPE_DIGIT=8,        // some character is a digit
+  SHAPE_ALL_DIGITS=16,  // every character is a digit
+  SHAPE_SENT_END=32,    // the token is ".", "!" or "?"
+  SHAPE_PERIOD=64       // the token is "."
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 // 'Token' denotes a word in the text.
 ////////////////////////////////////////////////////////////////////////////////
@@ -166,6 +240,29 @@ public:
   StringXML
   getString(const StringXML& original) const;
   
+////////////////////////////////////////////////////////////////////////////////
+// 'getView()' returns the string the token points to in 'original' without
+// copying it.
+////////////////////////////////////////////////////////////////////////////////
+  TokenView
+  getView(const StringXML& original) const;
+
+////////////////////////////////////////////////////////////////////////////////
+// 'getLength()' returns the number of characters of the token.
+////////////////////////////////////////////////////////////////////////////////
+  StringXML::size_type
+  getLength() const;
+
+////////////////////////////////////////////////////////////////////////////////
+// 'setShape()' and 'getShape()' set and return the TokenShape bits of the
+// token, which 'getToken' sets.
+////////////////////////////////////////////////////////////////////////////////
+  void
+  setShape(const unsigned int shape);
+
+  unsigned int
+  getShape() const;
+  
 protected:
 private:
 ////////////////////////////////////////////////////////////////////////////////
@@ -180,6 +277,11 @@ private:
 ////////////////////////////////////////////////////////////////////////////////
   StringXML::size_type _end;
 
+////////////////////////////////////////////////////////////////////////////////
+// '_shape' stores the TokenShape bits of the Token.
+////////////////////////////////////////////////////////////////////////////////
+  unsigned int _shape;
+
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -188,7 +290,7 @@ private:
 // empty (when there is no more token starting from begin and ending
 // before end) in that case it returns false.  It returns true if a
 // token was found.  The offset indicates the offset of begin in the
-// whole StringXML (if any).
+// whole StringXML (if any).  The shape of the token is set too.
 ////////////////////////////////////////////////////////////////////////////////
 bool
 getToken(const StringXML::const_iterator begin,
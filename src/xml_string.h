@@ -54,6 +54,7 @@
 #define __xml_string__
 
 #include <string>
+#include <ext/hash_map>
 
 using std::string;
 
@@ -64,6 +65,14 @@ namespace AF {
 // interface.
 typedef string StringXML;
 
+// hash function for strings, for use in hash_maps
+struct hash_str {
+  size_t
+  operator()(const string&s)const {
+    return __gnu_cxx::hash<const char*>()(s.c_str());
+  }
+};
+
 } // namespace AF
 
 #endif //__xml_string___